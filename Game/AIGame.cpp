@@ -1,278 +1,177 @@
 #include "AIGame.hpp"
+#include "Profiler.hpp"
 
 namespace SB {
 
-AIGame::AIGame() : h(0), w(0) {}
+AIGame::AIGame() : generation(0), worker(kEnemyPlanBudget) {}
+
+bool AIGame::buildAtlas(const std::vector<const sf::Texture*>& textures) {
+    if (!renderer.buildAtlas(textures)) return false;
+    renderer.load(game);
+    return true;
+}
 
 int AIGame::height() const {
-    return h;
+    return game.height();
 }
 
 int AIGame::width() const {
-    return w;
+    return game.width();
 }
 
 sf::Vector2u AIGame::playerLoc() const {
-    sf::Vector2f playerPos = player.getPosition();
-    int x = static_cast<int>(playerPos.x / 64);
-    int y = static_cast<int>(playerPos.y / 64);
-    return sf::Vector2u(x, y);
+    Point p = game.playerLoc();
+    return sf::Vector2u(p.x, p.y);
 }
 std::vector<sf::Vector2u> AIGame::enemyLocs() const {
     std::vector<sf::Vector2u> positions;
-    for (const auto& e : enemies) {
-        sf::Vector2f pos = e.getPosition();
-        int x = static_cast<int>(pos.x / 64);
-        int y = static_cast<int>(pos.y / 64);
-        positions.push_back(sf::Vector2u(x, y));
+    for (const auto& e : game.enemyLocs()) {
+        positions.push_back(sf::Vector2u(e.x, e.y));
     }
     return positions;
 }
 
-void AIGame::movePlayer(Direction direction) {
-    gameMatrixStack.push(gameMatrix);
-    sf::Vector2f prevPos = player.getPosition();
-    playerPositions.push(prevPos);
-
-    auto moveP = [this](int x, int y) {
-        sf::Vector2f newPos = player.getPosition() + sf::Vector2f(x, y);
-        int newX = newPos.x / 64;
-        int newY = newPos.y / 64;
-        int boxX = newX + x / 64;
-        int boxY = newY + y / 64;
-
-        if (newX >= 0 && newX < w && newY >= 0 && newY < h &&
-            gameMatrix[getArrayIndex(newX, newY)] != '#' &&
-            gameMatrix[getArrayIndex(newX, newY)] != 'A' &&
-            gameMatrix[getArrayIndex(newX, newY)] != '1') {
-            player.move(x, y);
-        }
-
-        if (boxX >= 0 && boxX < w && boxY >= 0 && boxY < h &&
-            gameMatrix[getArrayIndex(boxX, boxY)] != 'A' &&
-            gameMatrix[getArrayIndex(boxX, boxY)] != '#' &&
-            gameMatrix[getArrayIndex(boxX, boxY)] != '1') {
-            for (const auto& ghost : enemyLocs()) {
-        if (boxX == static_cast<int>(ghost.x) && boxY == static_cast<int>(ghost.y)) {
-            return; // block push into any ghost
-            }
-        }
-
-            if (gameMatrix[getArrayIndex(newX, newY)] == 'A') {
-                if (gameMatrix[getArrayIndex(boxX, boxY)] == 'a') {
-                    gameMatrix[getArrayIndex(boxX, boxY)] = '1';
-                    gameMatrix[getArrayIndex(newX, newY)] = '.';
-                    player.move(x, y);
-                } else {
-                    gameMatrix[getArrayIndex(boxX, boxY)] = 'A';
-                    gameMatrix[getArrayIndex(newX, newY)] = '.';
-                    player.move(x, y);
-                }
-            }
-
-            if (gameMatrix[getArrayIndex(newX, newY)] == '1') {
-                if (gameMatrix[getArrayIndex(boxX, boxY)] == 'a') {
-                    gameMatrix[getArrayIndex(boxX, boxY)] = '1';
-                    gameMatrix[getArrayIndex(newX, newY)] = 'a';
-                    player.move(x, y);
-                } else {
-                    gameMatrix[getArrayIndex(boxX, boxY)] = 'A';
-                    gameMatrix[getArrayIndex(newX, newY)] = 'a';
-                    player.move(x, y);
-                }
-            }
-        }
-    };
-
-    switch (direction) {
-        case Up:
-            playerDirections.push(Up);
-            moveP(0, -64);
-            break;
-        case Down:
-            playerDirections.push(Down);
-            moveP(0, 64);
-            break;
-        case Left:
-            moveP(-64, 0);
-            playerDirections.push(Left);
-            break;
-        case Right:
-            playerDirections.push(Right);
-            moveP(64, 0);
-            break;
-    }
-}
-
-float AIGame::heuristic(sf::Vector2u start, sf::Vector2u goal) const{
-    return std::abs((int)start.x - (int)goal.x) + std::abs((int)start.y - (int)goal.y);
+const GameState& AIGame::state() const {
+    return game;
 }
 
-std::vector<sf::Vector2u> AIGame::findPathAStar(sf::Vector2u start, sf::Vector2u goal, sf::Vector2u selfPos) const {
-    struct Node {
-        sf::Vector2u pos;
-        float g = 0;
-        float h = 0;
-        float f = 0;
-        Node* parent = nullptr;
-        bool walkable = true;
+sf::View AIGame::camera(sf::Vector2f size) const {
+    const float tile = TileRenderer::kTileSize;
+    auto axis = [tile](int at, float span, int tiles) {
+        float extent = tiles * tile;
+        if (extent <= span) return extent / 2;
+        return std::clamp(at * tile + tile / 2, span / 2, extent - span / 2);
     };
+    Point p = game.playerLoc();
+    sf::View view(sf::FloatRect(0, 0, size.x, size.y));
+    view.setCenter(axis(p.x, size.x, width()), axis(p.y, size.y, height()));
+    return view;
+}
 
-    auto inBounds = [&](sf::Vector2u p) {
-        return (int)p.x < width() && (int)p.y < height();
-    };
-
-    auto isWalkable = [&](sf::Vector2u p) {
-    if (!inBounds(p)) return false;
-
-    // Block static obstacles
-    char tile = gameMatrix[getArrayIndex(p.x, p.y)];
-    if (tile == '#' || tile == 'A' || tile == '1') return false;
-
-    // Block dynamic enemy positions
-    for (const auto& e : enemies) {
-        sf::Vector2f pos = e.getPosition();
-        unsigned int ex = static_cast<unsigned int>(pos.x / 64);
-        unsigned int ey = static_cast<unsigned int>(pos.y / 64);
-        if (selfPos.x == ex && selfPos.y == ey) continue;
-            if (p.x == ex && p.y == ey) return false;
+void AIGame::syncSprites() {
+    Point p = game.playerLoc();
+    player.setPosition(p.x * 64, p.y * 64);
+    const sf::Texture* facing = playerDownTex;
+    switch (game.playerFacing()) {
+        case Up: facing = playerUpTex; break;
+        case Down: facing = playerDownTex; break;
+        case Left: facing = playerLeftTex; break;
+        case Right: facing = playerRightTex; break;
     }
-    return true;
-};
-
-
-    std::vector<std::vector<Node>> grid(height(), std::vector<Node>(width()));
-    for (int y = 0; y < height(); ++y) {
-        for (int x = 0; x < width(); ++x) {
-            grid[y][x].pos = {static_cast<unsigned>(x), static_cast<unsigned>(y)};
-            grid[y][x].walkable = isWalkable({(unsigned)x, (unsigned)y});
+    if (facing) player.setTexture(*facing);
+
+    const auto& locs = game.enemyLocs();
+    enemies.resize(locs.size());
+    for (size_t i = 0; i < locs.size(); ++i) {
+        const sf::Texture* tex = enemyDownTex;
+        switch (game.enemyFacing(i)) {
+            case Up: tex = enemyUpTex; break;
+            case Down: tex = enemyDownTex; break;
+            case Left: tex = enemyLeftTex; break;
+            case Right: tex = enemyRightTex; break;
         }
+        if (tex) enemies[i].setTexture(*tex);
+        enemies[i].setPosition(locs[i].x * 64, locs[i].y * 64);
     }
+    if (renderer.ready()) renderer.update(game);
+}
 
-    auto cmp = [](Node* a, Node* b) { return a->f > b->f; };
-    std::priority_queue<Node*, std::vector<Node*>, decltype(cmp)> open(cmp);
-    std::unordered_set<size_t> closed;
-
-    Node* startNode = &grid[start.y][start.x];
-
-    startNode->g = 0;
-    startNode->h = heuristic(start, goal);
-    startNode->f = startNode->h;
-    open.push(startNode);
-
-    while (!open.empty()) {
-        Node* current = open.top();
-        open.pop();
-
-        if (current->pos == goal) {
-            std::vector<sf::Vector2u> path;
-            while (current) {
-                path.push_back(current->pos);
-                current = current->parent;
-            }
-            std::reverse(path.begin(), path.end());
-            return path;
-        }
-
-        closed.insert(getArrayIndex(current->pos.x, current->pos.y));
+void AIGame::movePlayer(Direction direction) {
+    SB_PROFILE_SCOPE("movePlayer");
+    Point from = game.playerLoc();
+    Point d = GameState::offset(direction);
+    int x = from.x + d.x;
+    int y = from.y + d.y;
+    bool intoBox = x >= 0 && x < width() && y >= 0 && y < height() &&
+                   game.occupancy().box(getArrayIndex(x, y));
+    Direction facing = game.playerFacing();
+    if (game.step(direction)) {
+        history.recordMove(direction, intoBox, facing);
+        replan();
+    }
+    recorder.recordMove(direction, game);
+    syncSprites();
+}
 
-        std::vector<sf::Vector2u> neighbors = {
-            {current->pos.x + 1, current->pos.y},
-            {current->pos.x - 1, current->pos.y},
-            {current->pos.x, current->pos.y + 1},
-            {current->pos.x, current->pos.y - 1}
-        };
+bool AIGame::undo() {
+    bool undone = history.undo(game);
+    recorder.recordUndo(game);
+    if (undone) replan();
+    syncSprites();
+    return undone;
+}
 
-        for (auto& npos : neighbors) {
-            if (!isWalkable(npos)) continue;
-            if (closed.count(getArrayIndex(npos.x, npos.y))) continue;
+bool AIGame::redo() {
+    bool redone = history.redo(game);
+    recorder.recordRedo(game);
+    if (redone) replan();
+    syncSprites();
+    return redone;
+}
 
-            Node* neighbor = &grid[npos.y][npos.x];
-            float tentativeG = current->g + 1;
+float AIGame::heuristic(sf::Vector2u start, sf::Vector2u goal) const{
+    return game.heuristic(Point{(int)start.x, (int)start.y}, Point{(int)goal.x, (int)goal.y});
+}
 
-            if (neighbor->parent == nullptr || tentativeG < neighbor->g) {
-                neighbor->parent = current;
-                neighbor->g = tentativeG;
-                neighbor->h = heuristic(npos, goal);
-                neighbor->f = neighbor->g + neighbor->h;
-                open.push(neighbor);
-            }
-        }
+std::vector<sf::Vector2u> AIGame::findPathAStar(sf::Vector2u start, sf::Vector2u goal, sf::Vector2u selfPos) const {
+    std::vector<sf::Vector2u> path;
+    for (const auto& p : game.findPathAStar(Point{(int)start.x, (int)start.y},
+                                            Point{(int)goal.x, (int)goal.y},
+                                            Point{(int)selfPos.x, (int)selfPos.y})) {
+        path.push_back(sf::Vector2u(p.x, p.y));
     }
-    return {}; 
+    return path;
 }
-int AIGame::evaluateState() const {
-    int bestScore = -1000; // Initialize with worst-case score
-
-    for (const auto& enemyPos : enemyLocs()) {
-        std::vector<sf::Vector2u> path = findPathAStar(enemyPos, playerLoc(), enemyPos);
-        if (!path.empty()) {
-            int score = -static_cast<int>(path.size());
-            if (score > bestScore) {
-                bestScore = score; // Closer enemy = better state
-            }
-        }
-    }
 
-    return bestScore;
+int AIGame::evaluateState() const {
+    return game.evaluateState();
 }
 
 void AIGame::moveEnemies() {
-    for (auto& e : enemies) {
-        sf::Vector2u current(
-            static_cast<unsigned>(e.getPosition().x / 64),
-            static_cast<unsigned>(e.getPosition().y / 64)
-        );
-        auto path = findPathAStar(current, playerLoc(), current);
-        if (path.size() >= 2) {
-            sf::Vector2u next = path[1];
-            sf::Vector2f newPos(next.x * 64, next.y * 64);
-
-            // Set direction-based texture
-            if (next.x > current.x) e.setTexture(*enemyRightTex);
-            else if (next.x < current.x) e.setTexture(*enemyLeftTex);
-            else if (next.y > current.y) e.setTexture(*enemyDownTex);
-            else if (next.y < current.y) e.setTexture(*enemyUpTex);
-
-            e.setPosition(newPos);
-        }
-    }
+    SB_PROFILE_SCOPE("moveEnemies");
+    enemiesBefore = game.enemyLocs();
+    // The worker has been planning since the last change. If that plan is
+    // not done yet the enemies take one greedy step down the distance field
+    // instead, and the late plan is dropped by the next request.
+    if (worker.take(generation, planned)) game.setEnemyLocs(planned);
+    else game.tickEnemies();
+    history.recordTick(enemiesBefore, game.enemyLocs());
+    recorder.recordTick(enemiesBefore, game);
+    replan();
+    syncSprites();
 }
 
-
+void AIGame::replan() {
+    worker.request(game, ++generation);
+}
 
 bool AIGame::isGameOver() {
-    for (const auto& e : enemies) {
-        sf::Vector2u ePos(
-            static_cast<unsigned>(e.getPosition().x / 64),
-            static_cast<unsigned>(e.getPosition().y / 64)
-        );
-        if (ePos == playerLoc()) return true;
-    }
-    return false;
+    return game.isGameOver();
 }
 
+Bitboard AIGame::reachableFromPlayer() const {
+    return game.reachableFromPlayer();
+}
 
 bool AIGame::isWon() {
-    int numBoxes = std::count_if(gameMatrix.begin(), gameMatrix.end(), [](char c) { return c == 'A'; });
-    int numStorage = std::count_if(gameMatrix.begin(), gameMatrix.end(), [](char c) { return c == 'a'; });
-
-    for (int i = 0; i < h * w; ++i) {
-        int x, y;
-        convertToMatrixSpace(i, x, y);
-        if ((gameMatrix[i] == '1' && numBoxes == 0) ||
-            (gameMatrix[i] == '1' && numStorage == 0) ||
-            (numBoxes == 0)) {
-            return true;
-        }
-    }
-    return false;
+    return game.isWon();
+}
+
+float AIGame::progress() const {
+    return game.progress();
 }
 
 void AIGame::draw(sf::RenderTarget& target, sf::RenderStates states) const {
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            char tile = gameMatrix[getArrayIndex(x, y)];
+    SB_PROFILE_SCOPE("draw");
+    if (renderer.ready()) {
+        target.draw(renderer, states);
+        return;
+    }
+
+    sf::IntRect visible = TileRenderer::visibleTiles(target, width(), height());
+    for (int y = visible.top; y < visible.top + visible.height; ++y) {
+        for (int x = visible.left; x < visible.left + visible.width; ++x) {
+            char tile = game.tile(x, y);
             sf::Sprite sprite;
 
             switch (tile) {
@@ -315,70 +214,78 @@ void AIGame::draw(sf::RenderTarget& target, sf::RenderStates states) const {
     for (const auto& e : enemies) {
     target.draw(e, states);
 }
+    SB_PROFILE_COUNT(DrawCalls, visible.width * visible.height + game.boxTotal() + 1 + enemies.size());
 
 
 }
 
-void AIGame::reset(const std::string& filePath) {
-    static sf::Texture down;
-    if (!down.loadFromFile("P_Down.png")) {
-        exit(1);
+bool AIGame::load(const std::string& filePath) {
+    if (!LevelFile::read(filePath, pristine)) return false;
+    levelPath = filePath;
+    restart(true);
+    return true;
+}
+
+void AIGame::restart(bool newLevel) {
+    game = pristine;
+    history.reset(game.enemyLocs().size());
+    if (recorder.recording()) {
+        if (newLevel) recorder.begin(game);
+        else recorder.recordRestart(game);
+    }
+    replan();
+    if (renderer.ready()) {
+        if (newLevel) renderer.load(game);
+        else renderer.update(game);
     }
-    player.setTexture(down);
+    syncSprites();
+}
+
+void AIGame::reset(const std::string& filePath) {
     enemies.clear();
 
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
+    if (filePath == levelPath) {
+        restart(false);
+    } else if (!load(filePath)) {
         std::cout << "Error opening file!" << std::endl;
         exit(1);
     }
-    file >> *this;
 }
 
-std::ifstream& operator>>(std::ifstream& in, AIGame& AIGame) {
-    in >> AIGame.h >> AIGame.w;
-    AIGame.gameMatrix.resize(AIGame.h * AIGame.w);
-
-    int playerX = -1, playerY = -1;
-
-    for (int i = 0; i < AIGame.h * AIGame.w; ++i) {
-        in >> AIGame.gameMatrix[i];
-        if (AIGame.gameMatrix[i] == '@') {
-            playerX = i % AIGame.w;
-            playerY = i / AIGame.w;
-        }
-        if (AIGame.gameMatrix[i] == 'G') {
-            int x = i % AIGame.w;
-            int y = i / AIGame.w;
-            sf::Sprite e;
-            e.setTexture(*AIGame.enemyDownTex); // or default
-            e.setPosition(x * 64, y * 64);
-            AIGame.enemies.push_back(e);
-        }
-    }
+void AIGame::record() {
+    recorder.begin(pristine);
+}
 
-    if (playerX != -1 && playerY != -1) {
-        sf::Vector2u playerPos(playerX, playerY);
-        AIGame.player.setPosition(playerPos.x * 64, playerPos.y * 64);
-    }
+bool AIGame::saveRecording(const std::string& path) const {
+    if (!recorder.save(path)) return false;
+    // Read it back and play it through: it has to end where the game is now
+    ReplayPlayer replay;
+    if (!replay.open(path) || !replay.start(pristine)) return false;
+    replay.playToEnd();
+    return replay.divergence() < 0 && replay.position() == replay.events() &&
+           stateHash(replay.state()) == stateHash(game);
+}
 
+std::ifstream& operator>>(std::ifstream& in, AIGame& AIGame) {
+    in >> AIGame.pristine;
+    AIGame.levelPath.clear();
+    AIGame.restart(true);
     return in;
 }
 
 
 std::ostream& operator<<(std::ostream& out, const AIGame& AIGame) {
-    out << AIGame.h << " " << AIGame.w;
+    out << AIGame.game;
     return out;
 }
 
 int AIGame::getArrayIndex(int x, int y) const {
-    return x + y * w;
+    return game.getArrayIndex(x, y);
 }
 
 void AIGame::convertToMatrixSpace(int i, int& x, int& y) const {
-    x = i % w;
-    y = i / w;
+    game.convertToMatrixSpace(i, x, y);
 }
 
 
-} // namespace SB
\ No newline at end of file
+} // namespace SB
@@ -1,7 +1,6 @@
 #ifndef AIGame_HPP
 #define AIGame_HPP
 
-#include <stack>
 #include <string>
 #include <algorithm>
 #include <vector>
@@ -10,13 +9,17 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/Window/Keyboard.hpp>
 #include <SFML/Audio.hpp>
-#include <queue>
-#include <unordered_set>
+#include "EnemyWorker.hpp"
+#include "GameState.hpp"
+#include "LevelFile.hpp"
+#include "MoveLog.hpp"
+#include "Replay.hpp"
+#include "TileRenderer.hpp"
 
 namespace SB {
 
-enum Direction { Up, Down, Left, Right };
-
+// SFML front end over a GameState: owns the sprites and keeps them in step
+// with the simulation, which knows nothing about pixels or textures.
 class AIGame : public sf::Drawable {
 public:
     sf::Sprite wall;
@@ -25,42 +28,81 @@ public:
     sf::Sprite storage;
     sf::Sprite player;
     std::vector<sf::Sprite> enemies;
-    sf::Texture* enemyUpTex = nullptr;
-    sf::Texture* enemyDownTex = nullptr;
-    sf::Texture* enemyLeftTex = nullptr;
-    sf::Texture* enemyRightTex = nullptr;
+    const sf::Texture* playerUpTex = nullptr;
+    const sf::Texture* playerDownTex = nullptr;
+    const sf::Texture* playerLeftTex = nullptr;
+    const sf::Texture* playerRightTex = nullptr;
+    const sf::Texture* enemyUpTex = nullptr;
+    const sf::Texture* enemyDownTex = nullptr;
+    const sf::Texture* enemyLeftTex = nullptr;
+    const sf::Texture* enemyRightTex = nullptr;
 
     AIGame();
 
+    // Switches drawing to the batched atlas renderer; see TileRenderer::Slot
+    // for the texture order. Without it every tile is drawn as a sprite.
+    bool buildAtlas(const std::vector<const sf::Texture*>& textures);
+
     int height() const;
     int width() const;
     sf::Vector2u playerLoc() const;
     std::vector<sf::Vector2u> enemyLocs() const;
     void movePlayer(Direction direction);
+    bool undo();
+    bool redo();
     float heuristic(sf::Vector2u start, sf::Vector2u goal) const;
     std::vector<sf::Vector2u> findPathAStar(sf::Vector2u start, sf::Vector2u goal, sf::Vector2u selfPos) const;
     void moveEnemies();
     int evaluateState() const;
     bool isWon();
+    float progress() const;
     bool isGameOver();
+    Bitboard reachableFromPlayer() const;
+    const GameState& state() const;
+    // A view of `size` pixels centred on the player and kept inside the
+    // map; a map smaller than the view is centred in it.
+    sf::View camera(sf::Vector2f size) const;
 
     friend std::ifstream& operator>>(std::ifstream& in, AIGame& AIGame);
     friend std::ostream& operator<<(std::ostream& out, const AIGame& AIGame);
 
     int getArrayIndex(int x, int y) const;
     void convertToMatrixSpace(int i, int& x, int& y) const;
+    // Loads a .lvl or compiled level and keeps a pristine copy of it.
+    bool load(const std::string& filePath);
+    // Restarting the loaded level copies the pristine state back instead of
+    // reading the file again.
     void reset(const std::string& filePath);
+    // Records the level loaded next, or already loaded, and every input and
+    // enemy tick after that. Any earlier recording is dropped.
+    void record();
+    // Writes the recording, then replays the file and checks that it ends
+    // in the state the game is in now.
+    bool saveRecording(const std::string& path) const;
 
 protected:
     virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
 
 private:
-    int h;
-    int w;
-    std::vector<char> gameMatrix;
-    std::stack<std::vector<char>> gameMatrixStack;
-    std::stack<sf::Vector2f> playerPositions;
-    std::stack<Direction> playerDirections;
+    void syncSprites();
+    void restart(bool newLevel);
+    // Starts planning the next enemy tick from the current state
+    void replan();
+
+    // Thinking time per plan. Every change starts a new plan, so one has
+    // to fit between a key press and the next 500 ms tick.
+    static constexpr double kEnemyPlanBudget = 0.05;
+
+    GameState game;
+    GameState pristine;
+    std::string levelPath;
+    TileRenderer renderer;
+    MoveLog history;
+    ReplayRecorder recorder;
+    std::vector<Point> enemiesBefore;
+    std::vector<Point> planned;
+    std::uint64_t generation;
+    EnemyWorker worker;
 };
 
 } // namespace SB
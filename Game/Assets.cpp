@@ -0,0 +1,96 @@
+#include "Assets.hpp"
+
+#include "WorkPool.hpp"
+
+namespace SB {
+
+namespace {
+
+bool hasExtension(const std::string& file, const std::string& extension) {
+    return file.size() >= extension.size() &&
+           file.compare(file.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+struct DecodedSound {
+    std::vector<sf::Int16> samples;
+    unsigned channels = 0;
+    unsigned rate = 0;
+    bool ok = false;
+};
+
+bool decodeSound(const std::string& file, DecodedSound& out) {
+    sf::InputSoundFile input;
+    if (!input.openFromFile(file)) return false;
+    out.samples.resize(input.getSampleCount());
+    out.channels = input.getChannelCount();
+    out.rate = input.getSampleRate();
+    return input.read(out.samples.data(), out.samples.size()) == out.samples.size();
+}
+
+}
+
+// Decoding PNG and WAV data is plain CPU work and safe off the main thread;
+// creating the GL texture and the audio buffer is not, so that part waits
+// until every decode has finished.
+bool Assets::preload(const std::vector<std::string>& files, bool parallel) {
+    std::vector<std::string> images, audio;
+    for (const auto& file : files) {
+        if (hasExtension(file, ".png") && !textures.count(file)) images.push_back(file);
+        else if (hasExtension(file, ".wav") && !sounds.count(file)) audio.push_back(file);
+        else if (hasExtension(file, ".ttf") && !font(file)) return false;
+    }
+
+    std::vector<sf::Image> decodedImages(images.size());
+    std::vector<char> imageOk(images.size(), 0);
+    std::vector<DecodedSound> decodedSounds(audio.size());
+    {
+        WorkPool pool(parallel ? 0 : 1);
+        for (size_t i = 0; i < images.size(); ++i) {
+            pool.submit([&, i] { imageOk[i] = decodedImages[i].loadFromFile(images[i]); });
+        }
+        for (size_t i = 0; i < audio.size(); ++i) {
+            pool.submit([&, i] { decodedSounds[i].ok = decodeSound(audio[i], decodedSounds[i]); });
+        }
+        pool.wait();
+    }
+
+    for (size_t i = 0; i < images.size(); ++i) {
+        auto texture = std::make_unique<sf::Texture>();
+        if (!imageOk[i] || !texture->loadFromImage(decodedImages[i])) return false;
+        textures[images[i]] = std::move(texture);
+    }
+    for (size_t i = 0; i < audio.size(); ++i) {
+        const DecodedSound& decoded = decodedSounds[i];
+        auto buffer = std::make_unique<sf::SoundBuffer>();
+        if (!decoded.ok || !buffer->loadFromSamples(decoded.samples.data(), decoded.samples.size(),
+                                                    decoded.channels, decoded.rate)) return false;
+        sounds[audio[i]] = std::move(buffer);
+    }
+    return true;
+}
+
+const sf::Texture* Assets::texture(const std::string& file) {
+    auto found = textures.find(file);
+    if (found != textures.end()) return found->second.get();
+    auto texture = std::make_unique<sf::Texture>();
+    if (!texture->loadFromFile(file)) return nullptr;
+    return (textures[file] = std::move(texture)).get();
+}
+
+const sf::SoundBuffer* Assets::sound(const std::string& file) {
+    auto found = sounds.find(file);
+    if (found != sounds.end()) return found->second.get();
+    auto buffer = std::make_unique<sf::SoundBuffer>();
+    if (!buffer->loadFromFile(file)) return nullptr;
+    return (sounds[file] = std::move(buffer)).get();
+}
+
+const sf::Font* Assets::font(const std::string& file) {
+    auto found = fonts.find(file);
+    if (found != fonts.end()) return found->second.get();
+    auto font = std::make_unique<sf::Font>();
+    if (!font->loadFromFile(file)) return nullptr;
+    return (fonts[file] = std::move(font)).get();
+}
+
+} // namespace SB
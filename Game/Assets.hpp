@@ -0,0 +1,38 @@
+#ifndef Assets_HPP
+#define Assets_HPP
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SFML/Audio.hpp>
+#include <SFML/Graphics.hpp>
+
+namespace SB {
+
+// Process-wide cache of textures, sound buffers and fonts, keyed by file
+// name. Each file is read and decoded once; the references handed out stay
+// valid for the life of the cache, so levels and menus can be rebuilt
+// without touching the disk again.
+class Assets {
+public:
+    // Loads every listed file, telling them apart by extension (.png, .wav,
+    // .ttf). With `parallel`, images and sounds are decoded on worker
+    // threads and only the uploads run on the calling thread.
+    bool preload(const std::vector<std::string>& files, bool parallel = true);
+
+    // Loads on first use if the file was not preloaded. Returns nullptr if
+    // it cannot be read.
+    const sf::Texture* texture(const std::string& file);
+    const sf::SoundBuffer* sound(const std::string& file);
+    const sf::Font* font(const std::string& file);
+
+private:
+    std::unordered_map<std::string, std::unique_ptr<sf::Texture>> textures;
+    std::unordered_map<std::string, std::unique_ptr<sf::SoundBuffer>> sounds;
+    std::unordered_map<std::string, std::unique_ptr<sf::Font>> fonts;
+};
+
+} // namespace SB
+
+#endif // Assets_HPP
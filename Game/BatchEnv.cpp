@@ -0,0 +1,254 @@
+#include "BatchEnv.hpp"
+
+#include <algorithm>
+
+namespace SB {
+
+namespace {
+
+inline bool testBit(const std::uint64_t* bits, int cell) {
+    return (bits[cell >> 6] >> (cell & 63)) & 1;
+}
+
+inline void setBit(std::uint64_t* bits, int cell) {
+    bits[cell >> 6] |= std::uint64_t(1) << (cell & 63);
+}
+
+inline void clearBit(std::uint64_t* bits, int cell) {
+    bits[cell >> 6] &= ~(std::uint64_t(1) << (cell & 63));
+}
+
+// Word k of `bits` moved `shift` cells toward higher indices (or lower ones
+// for a negative shift), with zeros shifted in at either end
+inline std::uint64_t shiftedWord(const std::uint64_t* bits, int words, int k, int shift) {
+    int q = (shift < 0 ? -shift : shift) >> 6;
+    int r = (shift < 0 ? -shift : shift) & 63;
+    std::uint64_t value = 0;
+    if (shift >= 0) {
+        if (k - q >= 0) value = bits[k - q] << r;
+        if (r && k - q - 1 >= 0) value |= bits[k - q - 1] >> (64 - r);
+    } else {
+        if (k + q < words) value = bits[k + q] >> r;
+        if (r && k + q + 1 < words) value |= bits[k + q + 1] << (64 - r);
+    }
+    return value;
+}
+
+// Neighbour order of FlowField::neighbors, which decides ties in descend()
+const Direction kDescendOrder[4] = {Right, Left, Down, Up};
+
+}
+
+BatchEnv::BatchEnv(const GameState& level, int instances, unsigned threads)
+    : w(level.width()), h(level.height()), cells(w * h), words((cells + 63) / 64), n(instances),
+      ghosts(static_cast<int>(level.enemyLocs().size())), boxTotal(0), goalTotal(0) {
+    walls.assign(words, 0);
+    open.assign(words, 0);
+    goals.assign(words, 0);
+    notFirstColumn.assign(words, 0);
+    notLastColumn.assign(words, 0);
+    startBoxes.assign(words, 0);
+    startPlaced = 0;
+    for (int i = 0; i < cells; ++i) {
+        char tile = level.tiles()[i];
+        if (tile == '#') setBit(walls.data(), i);
+        else setBit(open.data(), i);
+        if (tile == 'A' || tile == '1') {
+            setBit(startBoxes.data(), i);
+            ++boxTotal;
+        }
+        if (tile == 'a' || tile == '1') {
+            setBit(goals.data(), i);
+            ++goalTotal;
+        }
+        if (tile == '1') ++startPlaced;
+        if (i % w != 0) setBit(notFirstColumn.data(), i);
+        if (i % w != w - 1) setBit(notLastColumn.data(), i);
+    }
+
+    next.assign(static_cast<size_t>(cells) * 4, -1);
+    for (int i = 0; i < cells; ++i) {
+        for (int d = 0; d < 4; ++d) {
+            Point o = GameState::offset(static_cast<Direction>(d));
+            int x = i % w + o.x;
+            int y = i / w + o.y;
+            if (x >= 0 && x < w && y >= 0 && y < h) next[i * 4 + d] = x + y * w;
+        }
+    }
+
+    Point p = level.playerLoc();
+    startPlayer = p.x < 0 ? -1 : level.getArrayIndex(p.x, p.y);
+    for (const Point& e : level.enemyLocs()) {
+        startEnemies.push_back(level.getArrayIndex(e.x, e.y));
+    }
+
+    players.resize(n);
+    enemies.resize(static_cast<size_t>(ghosts) * n);
+    boxes.resize(static_cast<size_t>(words) * n);
+    placed.resize(n);
+    statuses.resize(n);
+    reset();
+
+    if (threads != 1) pool = std::make_unique<WorkPool>(threads);
+    // A few slices per thread so a slow slice does not hold up the rest
+    slices.resize(pool ? pool->size() * 4 : 1);
+}
+
+void BatchEnv::reset() {
+    for (int i = 0; i < n; ++i) reset(i);
+}
+
+void BatchEnv::reset(int i) {
+    players[i] = startPlayer;
+    for (int e = 0; e < ghosts; ++e) enemies[static_cast<size_t>(e) * n + i] = startEnemies[e];
+    std::copy(startBoxes.begin(), startBoxes.end(), boxes.begin() + static_cast<size_t>(i) * words);
+    placed[i] = startPlaced;
+    statuses[i] = BatchStatus::Playing;
+}
+
+void BatchEnv::step(const std::int8_t* actions, bool tickEnemies) {
+    if (!pool) {
+        stepRange(0, n, actions, tickEnemies, slices[0]);
+        return;
+    }
+    int count = static_cast<int>(slices.size());
+    for (int s = 0; s < count; ++s) {
+        int begin = static_cast<int>(static_cast<long long>(n) * s / count);
+        int end = static_cast<int>(static_cast<long long>(n) * (s + 1) / count);
+        pool->submit([this, begin, end, actions, tickEnemies, s] {
+            stepRange(begin, end, actions, tickEnemies, slices[s]);
+        });
+    }
+    pool->wait();
+}
+
+// Same order of checks as a headless game loop: the player moves, the game
+// may be won or lost, then the enemies move and may catch the player.
+void BatchEnv::stepRange(int begin, int end, const std::int8_t* actions, bool tickEnemies, Scratch& scratch) {
+    for (int i = begin; i < end; ++i) {
+        if (statuses[i] != BatchStatus::Playing) continue;
+        if (actions[i] >= 0 && actions[i] < 4) movePlayer(i, actions[i]);
+        settle(i);
+        if (statuses[i] != BatchStatus::Playing || !tickEnemies) continue;
+        moveEnemies(i, scratch);
+        settle(i);
+    }
+}
+
+bool BatchEnv::enemyAt(int i, int cell) const {
+    bool hit = false;
+    for (int e = 0; e < ghosts; ++e) hit |= enemies[static_cast<size_t>(e) * n + i] == cell;
+    return hit;
+}
+
+void BatchEnv::movePlayer(int i, int action) {
+    int from = players[i];
+    if (from < 0) return;
+    int to = next[from * 4 + action];
+    if (to < 0) return;
+
+    std::uint64_t* box = &boxes[static_cast<size_t>(i) * words];
+    bool wall = testBit(walls.data(), to);
+    bool pushing = testBit(box, to);
+    int beyond = pushing ? next[to * 4 + action] : -1;
+    bool pushes = beyond >= 0 && !testBit(walls.data(), beyond) && !testBit(box, beyond) && !enemyAt(i, beyond);
+    if (pushes) {
+        clearBit(box, to);
+        setBit(box, beyond);
+        placed[i] += static_cast<int>(testBit(goals.data(), beyond)) - static_cast<int>(testBit(goals.data(), to));
+    }
+    players[i] = !wall && (!pushing || pushes) ? to : from;
+}
+
+// Ring k holds every free cell within k steps of the player, so an enemy k
+// steps away moves to a neighbour in ring k - 1, the first free one in
+// FlowField's neighbour order. Enemies move one after another and block
+// each other, as in GameState::tickEnemies.
+void BatchEnv::moveEnemies(int i, Scratch& scratch) {
+    int player = players[i];
+    if (player < 0 || ghosts == 0) return;
+    const std::uint64_t* box = &boxes[static_cast<size_t>(i) * words];
+
+    std::vector<std::uint64_t>& rings = scratch.rings;
+    std::vector<int>& depth = scratch.depth;
+    depth.assign(ghosts, -1);
+    int remaining = 0;
+    for (int e = 0; e < ghosts; ++e) {
+        if (enemies[static_cast<size_t>(e) * n + i] == player) depth[e] = 0;
+        else ++remaining;
+    }
+
+    if (rings.size() < static_cast<size_t>(words) * 2) rings.resize(static_cast<size_t>(words) * 2);
+    std::fill(rings.begin(), rings.begin() + words, 0);
+    setBit(rings.data(), player);
+    for (int k = 0; remaining > 0; ++k) {
+        if (rings.size() < static_cast<size_t>(words) * (k + 2)) rings.resize(static_cast<size_t>(words) * (k + 2) * 2);
+        const std::uint64_t* ring = &rings[static_cast<size_t>(words) * k];
+        std::uint64_t* grown = &rings[static_cast<size_t>(words) * (k + 1)];
+        std::uint64_t changed = 0;
+        for (int word = 0; word < words; ++word) {
+            std::uint64_t v = ring[word] | (shiftedWord(ring, words, word, 1) & notFirstColumn[word]) |
+                              (shiftedWord(ring, words, word, -1) & notLastColumn[word]) |
+                              shiftedWord(ring, words, word, w) | shiftedWord(ring, words, word, -w);
+            v &= open[word] & ~box[word];
+            changed |= v ^ ring[word];
+            grown[word] = v;
+        }
+        if (!changed) break;
+        for (int e = 0; e < ghosts; ++e) {
+            if (depth[e] < 0 && testBit(grown, enemies[static_cast<size_t>(e) * n + i])) {
+                depth[e] = k + 1;
+                --remaining;
+            }
+        }
+    }
+
+    for (int e = 0; e < ghosts; ++e) {
+        if (depth[e] <= 0) continue;
+        std::int32_t& cell = enemies[static_cast<size_t>(e) * n + i];
+        const std::uint64_t* closer = &rings[static_cast<size_t>(words) * (depth[e] - 1)];
+        for (Direction d : kDescendOrder) {
+            int to = next[cell * 4 + d];
+            if (to < 0 || !testBit(closer, to) || enemyAt(i, to)) continue;
+            cell = to;
+            break;
+        }
+    }
+}
+
+void BatchEnv::settle(int i) {
+    if (placed[i] == boxTotal || (placed[i] == goalTotal && placed[i] > 0)) statuses[i] = BatchStatus::Won;
+    else if (enemyAt(i, players[i])) statuses[i] = BatchStatus::Lost;
+}
+
+int BatchEnv::size() const {
+    return n;
+}
+
+int BatchEnv::enemyCount() const {
+    return ghosts;
+}
+
+Point BatchEnv::player(int i) const {
+    int cell = players[i];
+    return cell < 0 ? Point{-1, -1} : Point{cell % w, cell / w};
+}
+
+Point BatchEnv::enemy(int i, int e) const {
+    int cell = enemies[static_cast<size_t>(e) * n + i];
+    return Point{cell % w, cell / w};
+}
+
+bool BatchEnv::box(int i, int cell) const {
+    return testBit(&boxes[static_cast<size_t>(i) * words], cell);
+}
+
+BatchStatus BatchEnv::status(int i) const {
+    return statuses[i];
+}
+
+unsigned BatchEnv::threads() const {
+    return pool ? pool->size() : 1;
+}
+
+} // namespace SB
@@ -0,0 +1,97 @@
+#ifndef BatchEnv_HPP
+#define BatchEnv_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "GameState.hpp"
+#include "WorkPool.hpp"
+
+namespace SB {
+
+enum class BatchStatus : std::uint8_t { Playing, Won, Lost };
+
+// Many copies of one level stepped in lockstep, for training and scoring
+// enemy or player policies. Walls, goals and the neighbour table are shared;
+// each instance is a player cell, one cell per enemy and a box bitset, kept
+// as structure-of-arrays:
+//
+//   player[i]              instance i's player cell
+//   enemy[e * N + i]       enemy e of instance i
+//   boxes[i * words ...]   instance i's boxes, 64 cells per word
+//
+// step() follows GameState::step and GameState::tickEnemies exactly. The
+// enemies' distance field is a bit-parallel BFS over the instance's free
+// cells, one word-wide dilation per ring, stopped once every enemy is
+// reached. An instance that is won or lost stays as it is until reset.
+class BatchEnv {
+public:
+    // Action that leaves the player where they are
+    static const std::int8_t kWait = 4;
+
+    // 0 threads means one per hardware thread
+    BatchEnv(const GameState& level, int instances, unsigned threads = 1);
+
+    void reset();
+    void reset(int instance);
+    // One action per instance, a Direction or kWait, then one enemy tick
+    // unless `tickEnemies` is false.
+    void step(const std::int8_t* actions, bool tickEnemies = true);
+
+    int size() const;
+    int enemyCount() const;
+    Point player(int instance) const;
+    Point enemy(int instance, int e) const;
+    bool box(int instance, int cell) const;
+    BatchStatus status(int instance) const;
+    unsigned threads() const;
+
+private:
+    // Per-slice scratch for the enemies' BFS
+    struct Scratch {
+        // Cells within k steps of the player, `words` words per ring k
+        std::vector<std::uint64_t> rings;
+        std::vector<int> depth;
+    };
+
+    void stepRange(int begin, int end, const std::int8_t* actions, bool tickEnemies, Scratch& scratch);
+    void movePlayer(int i, int action);
+    void moveEnemies(int i, Scratch& scratch);
+    bool enemyAt(int i, int cell) const;
+    void settle(int i);
+
+    int w;
+    int h;
+    int cells;
+    int words;
+    int n;
+    int ghosts;
+    int boxTotal;
+    int goalTotal;
+
+    std::vector<std::uint64_t> walls;
+    std::vector<std::uint64_t> open;
+    std::vector<std::uint64_t> goals;
+    std::vector<std::uint64_t> notFirstColumn;
+    std::vector<std::uint64_t> notLastColumn;
+    // Neighbour of each cell per Direction, -1 off the grid
+    std::vector<std::int32_t> next;
+
+    std::vector<std::int32_t> startEnemies;
+    std::vector<std::uint64_t> startBoxes;
+    std::int32_t startPlayer;
+    std::int32_t startPlaced;
+
+    std::vector<std::int32_t> players;
+    std::vector<std::int32_t> enemies;
+    std::vector<std::uint64_t> boxes;
+    std::vector<std::int32_t> placed;
+    std::vector<BatchStatus> statuses;
+
+    std::unique_ptr<WorkPool> pool;
+    std::vector<Scratch> slices;
+};
+
+} // namespace SB
+
+#endif // BatchEnv_HPP
@@ -0,0 +1,420 @@
+// Microbenchmarks for the hot paths, built by `make bench` against an
+// optimised AIGame.a. Every result is one JSON object per line:
+//
+//   {"op":"findPathAStar","scenario":"level1","samples":31,"ops":7936,
+//    "ns_median":812.4,"ns_min":790.1,"ns_p90":860.3,"allocs":2.00,"bytes":96.0}
+//
+// Times are per operation: the median, fastest and 90th percentile over
+// samples of back-to-back calls. allocs and bytes are heap allocations per
+// operation on the benchmarking thread. Stateful operations (moves, enemy
+// ticks) start every sample from the same state.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "AIGame.hpp"
+#include "Assets.hpp"
+#include "CooperativePlanner.hpp"
+#include "GameState.hpp"
+#include "LevelFile.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct AllocationCount {
+    std::uint64_t calls = 0;
+    std::uint64_t bytes = 0;
+};
+
+thread_local AllocationCount allocations;
+
+}
+
+// GCC sees malloc and free through the inlined operators and takes them for
+// a mismatched pair
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+    ++allocations.calls;
+    allocations.bytes += size;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+volatile std::size_t sink;
+
+struct Options {
+    std::string filter;
+    double seconds = 0.25;      // time budget per benchmark
+    size_t minSamples = 15;
+    size_t maxSamples = 1000;
+};
+
+struct Scenario {
+    std::string name;
+    std::string path;           // .lvl file
+    std::string text;           // its contents
+    SB::GameState state;
+    bool frontEndOnly = false;  // too big to time parsing and path queries on
+};
+
+class Bench {
+public:
+    explicit Bench(const Options& options) : options(options) {}
+
+    // Times `body(i)` for a running index i. A sample is `ops` calls after
+    // one call to `reset`, which is not timed; 0 ops picks a count that
+    // takes about a millisecond.
+    bool wants(const std::string& op, const std::string& scenario) const {
+        return options.filter.empty() || (op + "/" + scenario).find(options.filter) != std::string::npos;
+    }
+
+    void measure(const std::string& op, const std::string& scenario, int ops,
+                 const std::function<void()>& reset, const std::function<void(std::uint64_t)>& body) {
+        if (!wants(op, scenario)) return;
+
+        std::uint64_t index = 0;
+        reset();
+        auto begin = Clock::now();
+        body(index++);
+        double once = seconds(begin);
+        if (ops == 0) ops = static_cast<int>(std::clamp(1e-3 / std::max(once, 1e-9), 1.0, 100000.0));
+
+        std::vector<double> perOp;
+        AllocationCount total;
+        auto started = Clock::now();
+        while (perOp.size() < options.minSamples ||
+               (perOp.size() < options.maxSamples && seconds(started) < options.seconds)) {
+            reset();
+            AllocationCount before = allocations;
+            begin = Clock::now();
+            for (int i = 0; i < ops; ++i) body(index++);
+            double elapsed = seconds(begin);
+            total.calls += allocations.calls - before.calls;
+            total.bytes += allocations.bytes - before.bytes;
+            perOp.push_back(elapsed * 1e9 / ops);
+        }
+
+        std::sort(perOp.begin(), perOp.end());
+        double calls = static_cast<double>(perOp.size()) * ops;
+        std::cout << "{\"op\":\"" << op << "\",\"scenario\":\"" << scenario << "\",\"samples\":" << perOp.size()
+                  << ",\"ops\":" << static_cast<std::uint64_t>(calls)
+                  << ",\"ns_median\":" << perOp[perOp.size() / 2] << ",\"ns_min\":" << perOp.front()
+                  << ",\"ns_p90\":" << perOp[perOp.size() * 9 / 10]
+                  << ",\"allocs\":" << total.calls / calls << ",\"bytes\":" << total.bytes / calls << "}" << std::endl;
+    }
+
+    void skip(const std::string& op, const std::string& scenario, const std::string& reason) {
+        if (!wants(op, scenario)) return;
+        std::cout << "{\"op\":\"" << op << "\",\"scenario\":\"" << scenario << "\",\"skipped\":\"" << reason << "\"}"
+                  << std::endl;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static double seconds(Clock::time_point since) {
+        return std::chrono::duration<double>(Clock::now() - since).count();
+    }
+
+    Options options;
+};
+
+// A bordered room with scattered walls, boxes on free floor with a goal
+// each, the player in the middle and `ghosts` enemies spread around it.
+std::string syntheticLevel(int width, int height, int boxes, int ghosts, double wallDensity, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<char> grid(static_cast<size_t>(width) * height, '.');
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            bool border = x == 0 || y == 0 || x == width - 1 || y == height - 1;
+            if (border || std::uniform_real_distribution<double>(0, 1)(rng) < wallDensity) grid[x + y * width] = '#';
+        }
+    }
+    int player = width / 2 + height / 2 * width;
+    grid[player] = '@';
+    auto place = [&](char tile, int count) {
+        for (int placed = 0; placed < count;) {
+            int x = 2 + static_cast<int>(rng() % (width - 4));
+            int y = 2 + static_cast<int>(rng() % (height - 4));
+            if (grid[x + y * width] != '.') continue;
+            grid[x + y * width] = tile;
+            ++placed;
+        }
+    };
+    place('A', boxes);
+    place('a', boxes);
+    place('G', ghosts);
+
+    std::ostringstream out;
+    out << height << " " << width << "\n";
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) out << grid[x + y * width] << (x + 1 < width ? " " : "\n");
+    }
+    return out.str();
+}
+
+bool loadScenario(Scenario& scenario) {
+    std::ifstream in(scenario.path);
+    if (!in.is_open()) return false;
+    std::stringstream text;
+    text << in.rdbuf();
+    scenario.text = text.str();
+    std::istringstream parse(scenario.text);
+    parse >> scenario.state;
+    return true;
+}
+
+void benchState(Bench& bench, const Scenario& scenario, const fs::path& scratch) {
+    const std::string& name = scenario.name;
+    const SB::GameState& level = scenario.state;
+
+    bench.measure("parseLevel", name, 0, [] {}, [&scenario](std::uint64_t) {
+        SB::GameState state;
+        std::istringstream in(scenario.text);
+        in >> state;
+        sink = sink + state.width();
+    });
+
+    std::string compiled = (scratch / (name + SB::LevelFile::kExtension)).string();
+    if (SB::LevelFile::save(level, compiled)) {
+        bench.measure("loadCompiled", name, 0, [] {}, [&compiled](std::uint64_t) {
+            SB::GameState state;
+            SB::LevelFile::load(compiled, state);
+            sink = sink + state.width();
+        });
+    }
+
+    std::vector<SB::Point> open;
+    for (int y = 0; y < level.height(); ++y) {
+        for (int x = 0; x < level.width(); ++x) {
+            if (level.occupancy().walkable(level.getArrayIndex(x, y))) open.push_back(SB::Point{x, y});
+        }
+    }
+    std::mt19937 rng(1);
+    std::vector<std::pair<SB::Point, SB::Point>> pairs;
+    for (int i = 0; i < 256 && !open.empty(); ++i) {
+        pairs.emplace_back(open[rng() % open.size()], open[rng() % open.size()]);
+    }
+    std::vector<SB::Direction> moves;
+    for (int i = 0; i < 4096; ++i) moves.push_back(static_cast<SB::Direction>(rng() % 4));
+
+    SB::GameState state = level;
+    if (!pairs.empty()) {
+        bench.measure("findPathAStar", name, 0, [] {}, [&state, &pairs](std::uint64_t i) {
+            const auto& query = pairs[i % pairs.size()];
+            sink = sink + state.findPathAStar(query.first, query.second, query.first).size();
+        });
+    }
+
+    const int kTicks = 32;
+    bench.measure("step", name, kTicks, [&state, &level] { state = level; }, [&state, &moves](std::uint64_t i) {
+        sink = sink + state.step(moves[i % moves.size()]);
+    });
+    bench.measure("tickEnemies", name, kTicks, [&state, &level] { state = level; }, [&state](std::uint64_t) {
+        state.tickEnemies();
+    });
+
+    // A pack chasing a wandering player: one windowed cooperative plan per
+    // tick against a fresh grid A* for every enemy, each walking its first
+    // step when the tile is free. The second takes seconds a tick for the
+    // largest crowds and is left out there.
+    const int kChaseTicks = 8;
+    SB::CooperativePlanner crowd;
+    bench.measure("planCrowd", name, kChaseTicks, [&state, &level] { state = level; },
+                  [&state, &moves, &crowd](std::uint64_t i) {
+        if (i % 4 == 0) state.step(moves[i % moves.size()]);
+        state.settleField();
+        state.setEnemyLocs(crowd.plan(state));
+    });
+    if (level.enemyLocs().size() > 64) {
+        bench.skip("planEachEnemy", name, "too many enemies");
+    } else {
+        bench.measure("planEachEnemy", name, kChaseTicks, [&state, &level] { state = level; },
+                      [&state, &moves](std::uint64_t i) {
+            if (i % 4 == 0) state.step(moves[i % moves.size()]);
+            std::vector<SB::Point> next = state.enemyLocs();
+            for (SB::Point& enemy : next) {
+                std::vector<SB::Point> path = state.findPathAStar(enemy, state.playerLoc(), enemy);
+                if (path.size() > 1 && std::find(next.begin(), next.end(), path[1]) == next.end()) enemy = path[1];
+            }
+            state.setEnemyLocs(next);
+        });
+    }
+    state = level;
+    bench.measure("isWon", name, 0, [] {}, [&state](std::uint64_t) {
+        sink = sink + state.isWon();
+    });
+}
+
+void benchFrontEnd(Bench& bench, const Scenario& scenario, SB::Assets& assets, bool canDraw) {
+    const std::string& name = scenario.name;
+    std::mt19937 rng(2);
+    std::vector<SB::Direction> moves;
+    for (int i = 0; i < 4096; ++i) moves.push_back(static_cast<SB::Direction>(rng() % 4));
+
+    bool wanted = false;
+    for (const char* op : {"movePlayer", "moveEnemies", "isWon", "draw"}) wanted = wanted || bench.wants(op, name);
+    if (!wanted) return;
+
+    // The enemy planner keeps running on its own thread, as it does in game
+    SB::AIGame game;
+    if (!game.load(scenario.path)) {
+        std::cerr << "Failed to open file: " << scenario.path << std::endl;
+        return;
+    }
+    const int kTicks = 32;
+    auto reset = [&game, &scenario] { game.reset(scenario.path); };
+    bench.measure("movePlayer", name, kTicks, reset, [&game, &moves](std::uint64_t i) {
+        game.movePlayer(moves[i % moves.size()]);
+    });
+    bench.measure("moveEnemies", name, kTicks, reset, [&game](std::uint64_t) {
+        game.moveEnemies();
+    });
+    bench.measure("isWon", name + "/AIGame", 0, [] {}, [&game](std::uint64_t) {
+        sink = sink + game.isWon();
+    });
+
+    if (!canDraw) {
+        bench.skip("draw", name, "no OpenGL context");
+        return;
+    }
+    sf::RenderTexture target;
+    target.create(1024, 768);
+    target.setView(game.camera(sf::Vector2f(1024, 768)));
+    const char* files[SB::TileRenderer::SlotCount] = {
+        "Wall.png", "Crate.png", "floor.png", "Storage.png", "P_Up.png", "P_Down.png", "P_Left.png",
+        "P_Right.png", "E_Up.png", "E_Down.png", "E_Left.png", "E_Right.png"};
+    std::vector<const sf::Texture*> textures;
+    for (const char* file : files) textures.push_back(assets.texture(file));
+    if (std::find(textures.begin(), textures.end(), nullptr) != textures.end()) {
+        bench.skip("draw", name, "missing textures");
+        return;
+    }
+    game.wall.setTexture(*textures[SB::TileRenderer::Wall]);
+    game.box.setTexture(*textures[SB::TileRenderer::Box]);
+    game.empty.setTexture(*textures[SB::TileRenderer::Floor]);
+    game.storage.setTexture(*textures[SB::TileRenderer::Storage]);
+    game.player.setTexture(*textures[SB::TileRenderer::PlayerDown]);
+
+    auto draw = [&game, &target](std::uint64_t) {
+        target.clear();
+        target.draw(game);
+        target.display();
+    };
+    // One sprite per tile gets slow quickly; only the small maps draw that way
+    if (scenario.state.width() * scenario.state.height() <= 128 * 128) {
+        bench.measure("draw", name + "/sprites", 0, reset, draw);
+    }
+    game.buildAtlas(textures);
+    bench.measure("draw", name + "/atlas", 0, reset, draw);
+}
+
+}
+
+// AIGameBench [--filter TEXT] [--time SECONDS]: run from the Game directory
+// so that levels/ and the textures are found.
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) options.filter = argv[++i];
+        else if (arg == "--time" && i + 1 < argc) options.seconds = std::stod(argv[++i]);
+    }
+
+    fs::path scratch = fs::temp_directory_path() / "AIGameBench";
+    fs::create_directories(scratch);
+
+    std::vector<Scenario> scenarios;
+    std::vector<std::string> levels;
+    for (const auto& entry : fs::directory_iterator("levels")) {
+        if (entry.path().extension() == ".lvl") levels.push_back(entry.path().string());
+    }
+    std::sort(levels.begin(), levels.end());
+    for (const auto& path : levels) {
+        scenarios.push_back(Scenario{fs::path(path).stem().string(), path, "", SB::GameState()});
+    }
+
+    struct Synthetic {
+        const char* name;
+        int width, height, boxes, ghosts;
+        double walls;
+        bool frontEndOnly;
+    };
+    // Below and above GameState::kClusteredArea, crowds of ghosts, and a map
+    // for the per-frame cost of playing on a big, scrolling board
+    const Synthetic synthetic[] = {
+        {"grid96", 96, 96, 16, 4, 0.15, false},
+        {"grid512", 512, 512, 64, 8, 0.15, false},
+        {"ghosts64", 64, 64, 8, 64, 0.10, false},
+        {"ghosts256", 100, 100, 8, 256, 0.10, false},
+        {"grid2048", 2048, 2048, 64, 8, 0.15, true},
+    };
+    for (const auto& s : synthetic) {
+        std::string path = (scratch / (std::string(s.name) + ".lvl")).string();
+        std::ofstream out(path);
+        out << syntheticLevel(s.width, s.height, s.boxes, s.ghosts, s.walls, 7);
+        out.close();
+        scenarios.push_back(Scenario{s.name, path, "", SB::GameState(), s.frontEndOnly});
+    }
+
+    for (auto& scenario : scenarios) {
+        if (!loadScenario(scenario)) {
+            std::cerr << "Failed to open file: " << scenario.path << std::endl;
+            return 1;
+        }
+    }
+
+#ifdef SB_PROFILE
+    const bool profiled = true;
+#else
+    const bool profiled = false;
+#endif
+    std::cout << "{\"bench\":\"AIGame\",\"compiler\":\"" << __VERSION__ << "\",\"profile\":"
+              << (profiled ? "true" : "false") << ",\"seconds\":" << options.seconds << "}" << std::endl;
+
+    Bench bench(options);
+    SB::Assets assets;
+    sf::RenderTexture probe;
+    bool canDraw = probe.create(16, 16);
+    for (const auto& scenario : scenarios) {
+        if (!scenario.frontEndOnly) benchState(bench, scenario, scratch);
+        benchFrontEnd(bench, scenario, assets, canDraw);
+    }
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include "Bitboard.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace SB {
+
+Bitboard::Bitboard() : n(0) {}
+
+Bitboard::Bitboard(int cells) : n(0) {
+    resize(cells);
+}
+
+void Bitboard::resize(int cells) {
+    n = cells;
+    bits.assign((cells + 63) / 64, 0);
+}
+
+void Bitboard::clear() {
+    std::fill(bits.begin(), bits.end(), 0);
+}
+
+void Bitboard::fill() {
+    std::fill(bits.begin(), bits.end(), ~std::uint64_t(0));
+    trim();
+}
+
+int Bitboard::size() const {
+    return n;
+}
+
+bool Bitboard::test(int cell) const {
+    return (bits[cell >> 6] >> (cell & 63)) & 1;
+}
+
+void Bitboard::set(int cell) {
+    bits[cell >> 6] |= std::uint64_t(1) << (cell & 63);
+}
+
+void Bitboard::reset(int cell) {
+    bits[cell >> 6] &= ~(std::uint64_t(1) << (cell & 63));
+}
+
+void Bitboard::assign(int cell, bool value) {
+    if (value) set(cell);
+    else reset(cell);
+}
+
+bool Bitboard::any() const {
+    for (std::uint64_t word : bits) {
+        if (word) return true;
+    }
+    return false;
+}
+
+int Bitboard::count() const {
+    int total = 0;
+    for (std::uint64_t word : bits) total += __builtin_popcountll(word);
+    return total;
+}
+
+bool Bitboard::operator==(const Bitboard& other) const {
+    return n == other.n && bits == other.bits;
+}
+
+bool Bitboard::operator!=(const Bitboard& other) const {
+    return !(*this == other);
+}
+
+Bitboard& Bitboard::operator|=(const Bitboard& other) {
+    for (size_t i = 0; i < bits.size(); ++i) bits[i] |= other.bits[i];
+    return *this;
+}
+
+Bitboard& Bitboard::operator&=(const Bitboard& other) {
+    for (size_t i = 0; i < bits.size(); ++i) bits[i] &= other.bits[i];
+    return *this;
+}
+
+Bitboard& Bitboard::andNot(const Bitboard& other) {
+    for (size_t i = 0; i < bits.size(); ++i) bits[i] &= ~other.bits[i];
+    return *this;
+}
+
+void Bitboard::shiftInto(int cells, Bitboard& out) const {
+    out.n = n;
+    out.bits.resize(bits.size());
+    int count = static_cast<int>(bits.size());
+    int wordShift = std::abs(cells) / 64;
+    int bitShift = std::abs(cells) % 64;
+
+    for (int i = 0; i < count; ++i) {
+        std::uint64_t word = 0;
+        if (cells >= 0) {
+            int src = i - wordShift;
+            if (src >= 0) word = bits[src] << bitShift;
+            if (bitShift && src - 1 >= 0) word |= bits[src - 1] >> (64 - bitShift);
+        } else {
+            int src = i + wordShift;
+            if (src < count) word = bits[src] >> bitShift;
+            if (bitShift && src + 1 < count) word |= bits[src + 1] << (64 - bitShift);
+        }
+        out.bits[i] = word;
+    }
+    out.trim();
+}
+
+std::vector<std::uint64_t>& Bitboard::words() {
+    return bits;
+}
+
+const std::vector<std::uint64_t>& Bitboard::words() const {
+    return bits;
+}
+
+void Bitboard::trim() {
+    if (n % 64 && !bits.empty()) bits.back() &= (std::uint64_t(1) << (n % 64)) - 1;
+}
+
+Occupancy::Occupancy() : w(0), h(0) {}
+
+void Occupancy::build(const std::vector<char>& grid, int width, int height) {
+    w = width;
+    h = height;
+    for (Bitboard* plane : {&wallPlane, &boxPlane, &enemyPlane, &blockedPlane,
+                            &notFirstColumn, &notLastColumn}) {
+        plane->resize(w * h);
+    }
+    for (int i = 0; i < w * h; ++i) {
+        wallPlane.assign(i, grid[i] == '#');
+        boxPlane.assign(i, grid[i] == 'A' || grid[i] == '1');
+        notFirstColumn.assign(i, i % w != 0);
+        notLastColumn.assign(i, i % w != w - 1);
+        refresh(i);
+    }
+}
+
+bool Occupancy::wall(int cell) const {
+    return wallPlane.test(cell);
+}
+
+bool Occupancy::box(int cell) const {
+    return boxPlane.test(cell);
+}
+
+bool Occupancy::enemy(int cell) const {
+    return enemyPlane.test(cell);
+}
+
+bool Occupancy::walkable(int cell) const {
+    return !blockedPlane.test(cell);
+}
+
+bool Occupancy::solid(int cell) const {
+    return wallPlane.test(cell) || boxPlane.test(cell);
+}
+
+void Occupancy::refresh(int cell) {
+    blockedPlane.assign(cell, wallPlane.test(cell) || boxPlane.test(cell) || enemyPlane.test(cell));
+}
+
+void Occupancy::moveBox(int from, int to) {
+    boxPlane.reset(from);
+    boxPlane.set(to);
+    refresh(from);
+    refresh(to);
+}
+
+void Occupancy::placeEnemy(int cell) {
+    enemyPlane.set(cell);
+    refresh(cell);
+}
+
+void Occupancy::moveEnemy(int from, int to) {
+    enemyPlane.reset(from);
+    enemyPlane.set(to);
+    refresh(from);
+    refresh(to);
+}
+
+void Occupancy::clearEnemies() {
+    enemyPlane.clear();
+    blockedPlane = wallPlane;
+    blockedPlane |= boxPlane;
+}
+
+const Bitboard& Occupancy::walls() const {
+    return wallPlane;
+}
+
+const Bitboard& Occupancy::boxes() const {
+    return boxPlane;
+}
+
+const Bitboard& Occupancy::enemies() const {
+    return enemyPlane;
+}
+
+const Bitboard& Occupancy::blocked() const {
+    return blockedPlane;
+}
+
+void Occupancy::dilate(Bitboard& region, const Bitboard& open) const {
+    grown = region;
+    // A shift by one cell wraps row ends into the next row, so mask off the
+    // column the bits land in after wrapping.
+    region.shiftInto(1, scratch);
+    scratch &= notFirstColumn;
+    grown |= scratch;
+    region.shiftInto(-1, scratch);
+    scratch &= notLastColumn;
+    grown |= scratch;
+    region.shiftInto(w, scratch);
+    grown |= scratch;
+    region.shiftInto(-w, scratch);
+    grown |= scratch;
+    grown &= open;
+    std::swap(region, grown);
+}
+
+Bitboard Occupancy::reachable(int from, const Bitboard& obstacles) const {
+    Bitboard open(w * h);
+    open.fill();
+    open.andNot(obstacles);
+
+    Bitboard region(w * h);
+    if (from < 0 || from >= w * h || !open.test(from)) return region;
+    region.set(from);
+    do {
+        previous = region;
+        dilate(region, open);
+    } while (region != previous);
+    return region;
+}
+
+Bitboard Occupancy::reachable(int from) const {
+    return reachable(from, blockedPlane);
+}
+
+} // namespace SB
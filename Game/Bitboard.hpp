@@ -0,0 +1,99 @@
+#ifndef Bitboard_HPP
+#define Bitboard_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace SB {
+
+// One bit per grid cell, row-major, packed into 64-cell words. Cell i lives
+// in bit (i % 64) of word (i / 64), so moving a whole set one tile right or
+// down is a multi-word shift by 1 or by the row width.
+class Bitboard {
+public:
+    Bitboard();
+    explicit Bitboard(int cells);
+
+    void resize(int cells);
+    void clear();
+    void fill();
+    int size() const;
+
+    bool test(int cell) const;
+    void set(int cell);
+    void reset(int cell);
+    void assign(int cell, bool value);
+
+    bool any() const;
+    int count() const;
+    bool operator==(const Bitboard& other) const;
+    bool operator!=(const Bitboard& other) const;
+
+    Bitboard& operator|=(const Bitboard& other);
+    Bitboard& operator&=(const Bitboard& other);
+    Bitboard& andNot(const Bitboard& other);
+
+    // out = this shifted toward higher cell indices (positive) or lower ones
+    // (negative); bits pushed past either end are dropped.
+    void shiftInto(int cells, Bitboard& out) const;
+
+    std::vector<std::uint64_t>& words();
+    const std::vector<std::uint64_t>& words() const;
+
+private:
+    void trim();
+
+    int n;
+    std::vector<std::uint64_t> bits;
+};
+
+// Wall, box and enemy planes for a level, plus the union of all three so a
+// walkability test is a single bit probe.
+class Occupancy {
+public:
+    Occupancy();
+
+    void build(const std::vector<char>& grid, int width, int height);
+
+    bool wall(int cell) const;
+    bool box(int cell) const;
+    bool enemy(int cell) const;
+    bool walkable(int cell) const;
+    bool solid(int cell) const;
+
+    void moveBox(int from, int to);
+    void placeEnemy(int cell);
+    void moveEnemy(int from, int to);
+    void clearEnemies();
+
+    const Bitboard& walls() const;
+    const Bitboard& boxes() const;
+    const Bitboard& enemies() const;
+    const Bitboard& blocked() const;
+
+    // Grows `region` one tile in all four directions, restricted to `open`.
+    void dilate(Bitboard& region, const Bitboard& open) const;
+
+    // Every cell 4-connected to `from` without crossing a set bit of `obstacles`.
+    Bitboard reachable(int from, const Bitboard& obstacles) const;
+    Bitboard reachable(int from) const;
+
+private:
+    void refresh(int cell);
+
+    int w;
+    int h;
+    Bitboard wallPlane;
+    Bitboard boxPlane;
+    Bitboard enemyPlane;
+    Bitboard blockedPlane;
+    Bitboard notFirstColumn;
+    Bitboard notLastColumn;
+    mutable Bitboard scratch;
+    mutable Bitboard grown;
+    mutable Bitboard previous;
+};
+
+} // namespace SB
+
+#endif // Bitboard_HPP
@@ -0,0 +1,334 @@
+#include "ClusterGraph.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include "FlowField.hpp"
+
+namespace SB {
+
+ClusterGraph::ClusterGraph()
+    : w(0), h(0), across(0), down(0), anyDirty(false), generation(0), searchGeneration(0), expansions(0) {}
+
+void ClusterGraph::build(const std::vector<char>& grid, int width, int height) {
+    w = width;
+    h = height;
+    across = (w + kClusterSize - 1) / kClusterSize;
+    down = (h + kClusterSize - 1) / kClusterSize;
+    open.assign(w * h, 0);
+    for (int i = 0; i < w * h; ++i) {
+        open[i] = !FlowField::isObstacle(grid[i]);
+    }
+
+    stamp.assign(w * h, 0);
+    generation = 0;
+    dist.assign(w * h, 0);
+    parent.assign(w * h, -1);
+    searchStamp.assign(w * h, 0);
+    searchGeneration = 0;
+    g.assign(w * h, 0);
+    from.assign(w * h, -1);
+    heap.reset(w * h);
+
+    clusters.assign(across * down, Cluster());
+    borders.assign(2 * across * down, {});
+    borderDirty.assign(2 * across * down, 1);
+    anyDirty = true;
+    refresh();
+}
+
+bool ClusterGraph::built() const {
+    return !clusters.empty();
+}
+
+int ClusterGraph::clusterOf(int cell) const {
+    return (cell % w) / kClusterSize + (cell / w) / kClusterSize * across;
+}
+
+// Border b is the right edge of cluster b, or for b >= across*down the
+// bottom edge of cluster b - across*down. Short runs of open pairs get one
+// entrance in the middle, long ones one at each end.
+void ClusterGraph::scanBorder(int border) {
+    std::vector<std::pair<int, int>>& entrances = borders[border];
+    entrances.clear();
+    bool vertical = border < across * down;
+    int k = vertical ? border : border - across * down;
+    int cx = k % across;
+    int cy = k / across;
+    if ((vertical && cx + 1 >= across) || (!vertical && cy + 1 >= down)) return;
+
+    int length, first, step, otherSide;
+    if (vertical) {
+        int x = (cx + 1) * kClusterSize - 1;
+        first = x + cy * kClusterSize * w;
+        length = std::min(kClusterSize, h - cy * kClusterSize);
+        step = w;
+        otherSide = 1;
+    } else {
+        int y = (cy + 1) * kClusterSize - 1;
+        first = cx * kClusterSize + y * w;
+        length = std::min(kClusterSize, w - cx * kClusterSize);
+        step = 1;
+        otherSide = w;
+    }
+
+    int runStart = -1;
+    for (int i = 0; i <= length; ++i) {
+        int cell = first + i * step;
+        bool pair = i < length && open[cell] && open[cell + otherSide];
+        if (pair && runStart < 0) runStart = i;
+        if (pair || runStart < 0) continue;
+
+        int runLength = i - runStart;
+        if (runLength < 6) {
+            int mid = first + (runStart + runLength / 2) * step;
+            entrances.emplace_back(mid, mid + otherSide);
+        } else {
+            int a = first + runStart * step;
+            int b = first + (i - 1) * step;
+            entrances.emplace_back(a, a + otherSide);
+            entrances.emplace_back(b, b + otherSide);
+        }
+        runStart = -1;
+    }
+}
+
+int ClusterGraph::nodeIndex(const Cluster& cluster, int cell) const {
+    for (size_t i = 0; i < cluster.nodes.size(); ++i) {
+        if (cluster.nodes[i] == cell) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void ClusterGraph::rebuildCluster(int k) {
+    Cluster& cluster = clusters[k];
+    cluster.nodes.clear();
+    cluster.partners.clear();
+    auto add = [this, &cluster](int cell, int partner) {
+        int i = nodeIndex(cluster, cell);
+        if (i < 0) {
+            i = static_cast<int>(cluster.nodes.size());
+            cluster.nodes.push_back(cell);
+            cluster.partners.emplace_back();
+        }
+        cluster.partners[i].push_back(partner);
+    };
+
+    int cx = k % across;
+    int cy = k / across;
+    int below = across * down;
+    for (const auto& e : borders[k]) add(e.first, e.second);
+    if (cx > 0) for (const auto& e : borders[k - 1]) add(e.second, e.first);
+    for (const auto& e : borders[below + k]) add(e.first, e.second);
+    if (cy > 0) for (const auto& e : borders[below + k - across]) add(e.second, e.first);
+
+    size_t n = cluster.nodes.size();
+    cluster.distance.assign(n * n, kFar);
+    for (size_t i = 0; i < n; ++i) {
+        localSearch(cluster.nodes[i], k);
+        for (size_t j = 0; j < n; ++j) {
+            int d = localDistance(cluster.nodes[j]);
+            if (d >= 0) cluster.distance[i * n + j] = static_cast<std::uint16_t>(d);
+        }
+    }
+    cluster.dirty = false;
+}
+
+void ClusterGraph::refresh() {
+    if (!anyDirty) return;
+    int below = across * down;
+    for (int b = 0; b < 2 * below; ++b) {
+        if (!borderDirty[b]) continue;
+        scanBorder(b);
+        borderDirty[b] = 0;
+        int k = b < below ? b : b - below;
+        clusters[k].dirty = true;
+        int other = b < below ? k + 1 : k + across;
+        if (other < below) clusters[other].dirty = true;
+    }
+    for (int k = 0; k < below; ++k) {
+        if (clusters[k].dirty) rebuildCluster(k);
+    }
+    anyDirty = false;
+}
+
+// A tile only matters to the entrances of the borders it lies on; the
+// cluster's own distances are redone wherever it lies.
+void ClusterGraph::setBlocked(int cell, bool isBlocked) {
+    if (!built() || open[cell] == !isBlocked) return;
+    open[cell] = !isBlocked;
+
+    int k = clusterOf(cell);
+    int x = cell % w;
+    int y = cell / w;
+    int below = across * down;
+    clusters[k].dirty = true;
+    if (x % kClusterSize == kClusterSize - 1) borderDirty[k] = 1;
+    if (x % kClusterSize == 0 && x > 0) borderDirty[k - 1] = 1;
+    if (y % kClusterSize == kClusterSize - 1) borderDirty[below + k] = 1;
+    if (y % kClusterSize == 0 && y > 0) borderDirty[below + k - across] = 1;
+    anyDirty = true;
+}
+
+void ClusterGraph::localSearch(int origin, int k) {
+    if (++generation == 0) {
+        std::fill(stamp.begin(), stamp.end(), 0);
+        generation = 1;
+    }
+    int x0 = (k % across) * kClusterSize;
+    int y0 = (k / across) * kClusterSize;
+    int x1 = std::min(x0 + kClusterSize, w);
+    int y1 = std::min(y0 + kClusterSize, h);
+
+    queue.clear();
+    queue.push_back(origin);
+    stamp[origin] = generation;
+    dist[origin] = 0;
+    parent[origin] = -1;
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int cell = queue[head];
+        int x = cell % w;
+        int y = cell / w;
+        int adj[4] = {x + 1 < x1 ? cell + 1 : -1, x > x0 ? cell - 1 : -1,
+                      y + 1 < y1 ? cell + w : -1, y > y0 ? cell - w : -1};
+        for (int next : adj) {
+            if (next < 0 || !open[next] || stamp[next] == generation) continue;
+            stamp[next] = generation;
+            dist[next] = dist[cell] + 1;
+            parent[next] = cell;
+            queue.push_back(next);
+        }
+    }
+}
+
+int ClusterGraph::localDistance(int cell) const {
+    return stamp[cell] == generation ? dist[cell] : -1;
+}
+
+bool ClusterGraph::findWaypoints(int start, int goal, std::vector<int>& waypoints) {
+    waypoints.clear();
+    expansions = 0;
+    if (!built() || start < 0 || goal < 0 || start >= w * h || goal >= w * h) return false;
+    refresh();
+
+    int startCluster = clusterOf(start);
+    int goalCluster = clusterOf(goal);
+    const Cluster& last = clusters[goalCluster];
+    localSearch(goal, goalCluster);
+    goalDistance.assign(last.nodes.size(), -1);
+    for (size_t i = 0; i < last.nodes.size(); ++i) {
+        goalDistance[i] = localDistance(last.nodes[i]);
+    }
+    int direct = startCluster == goalCluster ? localDistance(start) : -1;
+    const Cluster& first = clusters[startCluster];
+    localSearch(start, startCluster);
+    startDistance.assign(first.nodes.size(), -1);
+    for (size_t i = 0; i < first.nodes.size(); ++i) {
+        startDistance[i] = localDistance(first.nodes[i]);
+    }
+
+    if (++searchGeneration == 0) {
+        std::fill(searchStamp.begin(), searchStamp.end(), 0);
+        searchGeneration = 1;
+    }
+    heap.clear();
+    int gx = goal % w;
+    int gy = goal / w;
+    auto estimate = [this, gx, gy](int cell) {
+        return std::abs(cell % w - gx) + std::abs(cell / w - gy);
+    };
+    int current = start;
+    auto relax = [&](int next, int cost) {
+        int tentative = g[current] + cost;
+        if (searchStamp[next] != searchGeneration) {
+            searchStamp[next] = searchGeneration;
+            g[next] = tentative;
+            from[next] = current;
+            heap.push(next, tentative + estimate(next));
+        } else if (tentative < g[next]) {
+            g[next] = tentative;
+            from[next] = current;
+            heap.decrease(next, tentative + estimate(next));
+        }
+    };
+
+    searchStamp[start] = searchGeneration;
+    g[start] = 0;
+    from[start] = -1;
+    heap.push(start, estimate(start));
+    while (!heap.empty()) {
+        current = heap.pop();
+        if (current == goal) {
+            for (int c = goal; c != -1; c = from[c]) waypoints.push_back(c);
+            std::reverse(waypoints.begin(), waypoints.end());
+            return true;
+        }
+        ++expansions;
+
+        if (current == start) {
+            for (size_t i = 0; i < first.nodes.size(); ++i) {
+                if (startDistance[i] >= 0) relax(first.nodes[i], startDistance[i]);
+            }
+            if (direct >= 0) relax(goal, direct);
+        }
+        int k = clusterOf(current);
+        const Cluster& cluster = clusters[k];
+        int i = nodeIndex(cluster, current);
+        if (i < 0) continue;
+        size_t n = cluster.nodes.size();
+        for (size_t j = 0; j < n; ++j) {
+            std::uint16_t d = cluster.distance[i * n + j];
+            if (d != kFar && static_cast<int>(j) != i) relax(cluster.nodes[j], d);
+        }
+        for (int partner : cluster.partners[i]) relax(partner, 1);
+        if (k == goalCluster && goalDistance[i] >= 0) relax(goal, goalDistance[i]);
+    }
+    return false;
+}
+
+bool ClusterGraph::refine(int a, int b, std::vector<int>& path) {
+    if (a == b) return true;
+    if (std::abs(a % w - b % w) + std::abs(a / w - b / w) == 1) {
+        path.push_back(b);
+        return true;
+    }
+    int k = clusterOf(a);
+    if (clusterOf(b) != k) return false;
+
+    // Search from b so the walk from a can follow falling distances
+    localSearch(b, k);
+    if (localDistance(a) < 0) return false;
+    for (int cell = a; cell != b; cell = parent[cell]) {
+        path.push_back(parent[cell]);
+    }
+    return true;
+}
+
+bool ClusterGraph::findPath(int start, int goal, std::vector<int>& path) {
+    path.clear();
+    std::vector<int> waypoints;
+    if (!findWaypoints(start, goal, waypoints)) return false;
+    path.push_back(start);
+    for (size_t i = 1; i < waypoints.size(); ++i) {
+        if (!refine(waypoints[i - 1], waypoints[i], path)) {
+            path.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t ClusterGraph::entranceCount() const {
+    size_t count = 0;
+    for (const Cluster& cluster : clusters) count += cluster.nodes.size();
+    return count;
+}
+
+unsigned ClusterGraph::expanded() const {
+    return expansions;
+}
+
+unsigned ClusterGraph::pushes() const {
+    return heap.pushes();
+}
+
+} // namespace SB
@@ -0,0 +1,93 @@
+#ifndef ClusterGraph_HPP
+#define ClusterGraph_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "PathContext.hpp"
+
+namespace SB {
+
+// Hierarchical pathfinding (HPA*) over the level grid. The grid is cut into
+// square clusters; every run of open cells along a cluster border becomes
+// one or two entrances, and each cluster caches the walking distance between
+// its own entrances. A query searches this small entrance graph and turns
+// the result into tiles one cluster-sized segment at a time.
+//
+// Walls and boxes are obstacles. When a tile changes, only the cluster that
+// holds it and the clusters sharing its borders are rebuilt, on the next
+// query.
+class ClusterGraph {
+public:
+    static constexpr int kClusterSize = 16;
+
+    ClusterGraph();
+
+    void build(const std::vector<char>& grid, int width, int height);
+    bool built() const;
+    void setBlocked(int cell, bool isBlocked);
+
+    // Entrance cells from start to goal, both included; start and goal need
+    // not be entrances.
+    bool findWaypoints(int start, int goal, std::vector<int>& waypoints);
+    // Tiles after `from` up to and including `to`, where both lie in one
+    // cluster or are neighbours. This is the lazy refinement step.
+    bool refine(int from, int to, std::vector<int>& path);
+    // Full tile path from start to goal, start included.
+    bool findPath(int start, int goal, std::vector<int>& path);
+
+    size_t entranceCount() const;
+    unsigned expanded() const;
+    unsigned pushes() const;
+
+private:
+    struct Cluster {
+        std::vector<int> nodes;                  // entrance cells
+        std::vector<std::vector<int>> partners;  // cells across the border
+        std::vector<std::uint16_t> distance;     // nodes x nodes
+        bool dirty = true;
+    };
+
+    static constexpr std::uint16_t kFar = 0xFFFF;
+
+    int clusterOf(int cell) const;
+    void scanBorder(int border);
+    void rebuildCluster(int cluster);
+    void refresh();
+    // BFS from `from` that stays inside `cluster`; distances land in `dist`
+    // under the current stamp.
+    void localSearch(int from, int cluster);
+    int localDistance(int cell) const;
+    int nodeIndex(const Cluster& cluster, int cell) const;
+
+    int w;
+    int h;
+    int across;
+    int down;
+    std::vector<char> open;
+    // Borders 0..across*down-1 lie right of their cluster, the rest below;
+    // each holds (cell on this side, cell on the other side) pairs.
+    std::vector<std::vector<std::pair<int, int>>> borders;
+    std::vector<char> borderDirty;
+    std::vector<Cluster> clusters;
+    bool anyDirty;
+
+    std::vector<unsigned> stamp;
+    unsigned generation;
+    std::vector<int> dist;
+    std::vector<int> parent;
+    std::vector<int> queue;
+
+    std::vector<unsigned> searchStamp;
+    unsigned searchGeneration;
+    std::vector<int> g;
+    std::vector<int> from;
+    std::vector<int> startDistance;
+    std::vector<int> goalDistance;
+    IndexedHeap heap;
+    unsigned expansions;
+};
+
+} // namespace SB
+
+#endif // ClusterGraph_HPP
@@ -0,0 +1,280 @@
+#include "CooperativePlanner.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace SB {
+
+namespace {
+
+const std::uint64_t kEmptyKey = ~std::uint64_t(0);
+
+}
+
+CooperativePlanner::SlotMap::SlotMap() : generation(1), used(0) {
+    keys.assign(64, kEmptyKey);
+    values.assign(64, -1);
+    stamps.assign(64, 0);
+}
+
+void CooperativePlanner::SlotMap::clear() {
+    ++generation;
+    used = 0;
+}
+
+size_t CooperativePlanner::SlotMap::slot(std::uint64_t key) const {
+    size_t mask = keys.size() - 1;
+    size_t i = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    while (stamps[i] == generation && keys[i] != key) i = (i + 1) & mask;
+    return i;
+}
+
+const int* CooperativePlanner::SlotMap::find(std::uint64_t key) const {
+    size_t i = slot(key);
+    return stamps[i] == generation ? &values[i] : nullptr;
+}
+
+void CooperativePlanner::SlotMap::set(std::uint64_t key, int value) {
+    if ((used + 1) * 2 > keys.size()) grow();
+    size_t i = slot(key);
+    if (stamps[i] != generation) {
+        stamps[i] = generation;
+        keys[i] = key;
+        ++used;
+    }
+    values[i] = value;
+}
+
+void CooperativePlanner::SlotMap::grow() {
+    std::vector<std::uint64_t> oldKeys(keys.size() * 2, kEmptyKey);
+    std::vector<int> oldValues(values.size() * 2, -1);
+    std::vector<unsigned> oldStamps(stamps.size() * 2, 0);
+    oldKeys.swap(keys);
+    oldValues.swap(values);
+    oldStamps.swap(stamps);
+    unsigned live = generation;
+    generation = 1;
+    used = 0;
+    for (size_t i = 0; i < oldKeys.size(); ++i) {
+        if (oldStamps[i] == live) set(oldKeys[i], oldValues[i]);
+    }
+}
+
+CooperativePlanner::CooperativePlanner() : w(0), h(0), player(-1), searchCount(0), expanded(0), cancel(nullptr) {}
+
+void CooperativePlanner::setCancelFlag(const std::atomic<bool>* flag) {
+    cancel = flag;
+}
+
+std::uint64_t CooperativePlanner::key(int cell, int tick) const {
+    return static_cast<std::uint64_t>(tick) * w * h + cell;
+}
+
+int CooperativePlanner::reservedBy(int cell, int tick) const {
+    const int* owner = reservations.find(key(cell, tick));
+    return owner ? *owner : -1;
+}
+
+// Every tick of the window, holding the path's last cell once it runs out
+void CooperativePlanner::reserve(int enemy) {
+    const std::vector<int>& path = paths[enemy];
+    for (int tick = 0; tick <= kWindow; ++tick) {
+        int cell = path[std::min<size_t>(tick, path.size() - 1)];
+        reservations.set(key(cell, tick), enemy);
+    }
+}
+
+// Frees the enemy's slots after tick 0, where it stands whatever it plans
+void CooperativePlanner::release(int enemy) {
+    const std::vector<int>& path = paths[enemy];
+    for (int tick = 1; tick <= kWindow; ++tick) {
+        int cell = path[std::min<size_t>(tick, path.size() - 1)];
+        if (reservedBy(cell, tick) == enemy) reservations.set(key(cell, tick), -1);
+    }
+}
+
+int CooperativePlanner::estimate(const GameState& state, int cell) const {
+    int d = state.flowField().distance(cell);
+    return d == FlowField::kUnreachable ? w * h : d;
+}
+
+// The paths cached last time still hold if the player and the boxes are
+// where they were and every enemy is either where its path starts or one
+// step along it, the same for all of them.
+bool CooperativePlanner::stillValid(const GameState& state) const {
+    const std::vector<Point>& locs = state.enemyLocs();
+    if (state.width() != w || state.height() != h || paths.size() != locs.size()) return false;
+    Point p = state.playerLoc();
+    if (state.getArrayIndex(p.x, p.y) != player || state.occupancy().boxes() != boxes) return false;
+    for (size_t i = 0; i < locs.size(); ++i) {
+        if (paths[i].empty()) return false;
+    }
+    return true;
+}
+
+std::vector<Point> CooperativePlanner::plan(const GameState& state) {
+    SB_PROFILE_SCOPE("planCrowd");
+    searchCount = 0;
+    expanded = 0;
+    const std::vector<Point>& locs = state.enemyLocs();
+    int count = static_cast<int>(locs.size());
+    if (count == 0 || state.isGameOver()) return locs;
+
+    std::vector<int> now(count);
+    for (int i = 0; i < count; ++i) now[i] = state.getArrayIndex(locs[i].x, locs[i].y);
+
+    bool valid = stillValid(state);
+    if (valid) {
+        bool stayed = true;
+        bool advanced = true;
+        for (int i = 0; i < count; ++i) {
+            const std::vector<int>& path = paths[i];
+            stayed = stayed && path[0] == now[i];
+            advanced = advanced && path[std::min<size_t>(1, path.size() - 1)] == now[i];
+        }
+        if (advanced) {
+            for (auto& path : paths) {
+                if (path.size() > 1) path.erase(path.begin());
+            }
+        }
+        valid = advanced || stayed;
+    }
+
+    reservations.clear();
+    std::vector<char> replan(count, !valid);
+    if (!valid) {
+        w = state.width();
+        h = state.height();
+        Point p = state.playerLoc();
+        player = state.getArrayIndex(p.x, p.y);
+        boxes = state.occupancy().boxes();
+        paths.assign(count, {});
+        for (int i = 0; i < count; ++i) {
+            paths[i].push_back(now[i]);
+            reservations.set(key(now[i], 0), i);
+        }
+    } else {
+        for (int i = 0; i < count; ++i) {
+            replan[i] = static_cast<int>(paths[i].size()) <= kWindow / 2;
+            reserve(i);
+        }
+    }
+
+    // Closest to the player first, so the ones in front clear the way
+    order.resize(count);
+    for (int i = 0; i < count; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this, &state, &now](int a, int b) {
+        return estimate(state, now[a]) < estimate(state, now[b]);
+    });
+    for (int enemy : order) {
+        if (!replan[enemy]) continue;
+        // Cancelled: half the pack has fresh paths, so all start over next time
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            paths.clear();
+            return locs;
+        }
+        if (valid) release(enemy);
+        search(state, enemy);
+        reserve(enemy);
+    }
+
+    // A boxed-in enemy can find every way out, even standing still, taken
+    // by those that planned before it. It stays put and whoever would
+    // run into it stays too; the paths start over next time.
+    std::vector<int> next(count);
+    for (int i = 0; i < count; ++i) next[i] = paths[i][std::min<size_t>(1, paths[i].size() - 1)];
+    bool clash = true;
+    bool clashed = false;
+    while (clash) {
+        clash = false;
+        for (int i = 0; i < count; ++i) {
+            for (int j = i + 1; j < count; ++j) {
+                if (next[i] != next[j] && (next[i] != now[j] || next[j] != now[i])) continue;
+                int k = next[i] != now[i] ? i : j;
+                next[k] = now[k];
+                clash = true;
+            }
+        }
+        clashed = clashed || clash;
+    }
+    if (clashed) paths.clear();
+
+    std::vector<Point> result;
+    for (int cell : next) result.push_back(Point{cell % w, cell / w});
+    SB_PROFILE_COUNT(PlannerNodes, expanded);
+    return result;
+}
+
+// Space-time A* from the enemy's cell to the player, over at most kWindow
+// ticks. Every step, waiting included, costs one tick, so a node's cost is
+// its tick and each (cell, tick) pair is reached at most once.
+void CooperativePlanner::search(const GameState& state, int enemy) {
+    ++searchCount;
+    const Occupancy& occ = state.occupancy();
+    int start = paths[enemy][0];
+    // Cut off from the player: nothing to head for, so it holds its tile
+    paths[enemy].assign(1, start);
+    if (state.flowField().distance(start) == FlowField::kUnreachable) return;
+    nodes.clear();
+    visited.clear();
+    open.clear();
+
+    // Lowest f first, and the deepest node among equals
+    auto push = [this, &state](int node) {
+        const Node& n = nodes[node];
+        open.emplace_back((n.tick + estimate(state, n.cell)) * 32 - n.tick, node);
+        std::push_heap(open.begin(), open.end(), std::greater<std::pair<int, int>>());
+    };
+    nodes.push_back(Node{start, 0, -1});
+    visited.set(key(start, 0), 0);
+    push(0);
+
+    int best = -1;
+    while (!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), std::greater<std::pair<int, int>>());
+        int index = open.back().second;
+        open.pop_back();
+        Node current = nodes[index];
+        ++expanded;
+        if (current.cell == player || current.tick == kWindow) {
+            best = index;
+            break;
+        }
+
+        int x = current.cell % w;
+        int tick = current.tick + 1;
+        // FlowField's neighbour order, then waiting
+        int moves[5] = {x + 1 < w ? current.cell + 1 : -1, x > 0 ? current.cell - 1 : -1,
+                        current.cell + w < w * h ? current.cell + w : -1, current.cell - w, current.cell};
+        for (int next : moves) {
+            if (next < 0 || occ.solid(next)) continue;
+            int owner = reservedBy(next, tick);
+            if (owner >= 0 && owner != enemy) continue;
+            if (next != current.cell) {
+                int facing = reservedBy(next, current.tick);
+                if (facing >= 0 && facing != enemy && reservedBy(current.cell, tick) == facing) continue;
+            }
+            std::uint64_t k = key(next, tick);
+            if (visited.find(k)) continue;
+            visited.set(k, static_cast<int>(nodes.size()));
+            nodes.push_back(Node{next, tick, index});
+            push(static_cast<int>(nodes.size()) - 1);
+        }
+    }
+
+    if (best < 0) return;
+    std::vector<int>& path = paths[enemy];
+    path.resize(nodes[best].tick + 1);
+    for (int n = best; n >= 0; n = nodes[n].parent) path[nodes[n].tick] = nodes[n].cell;
+}
+
+int CooperativePlanner::searches() const {
+    return searchCount;
+}
+
+unsigned CooperativePlanner::expansions() const {
+    return expanded;
+}
+
+} // namespace SB
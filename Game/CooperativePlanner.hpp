@@ -0,0 +1,95 @@
+#ifndef CooperativePlanner_HPP
+#define CooperativePlanner_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "GameState.hpp"
+
+namespace SB {
+
+// Windowed cooperative A* (WHCA*) for packs of enemies too large for
+// EnemyPlanner's joint search. Enemies plan one at a time, closest to the
+// player first, through space and time: each path covers the next kWindow
+// ticks and is written into a shared reservation table of (tick, cell)
+// slots, and later enemies route around those slots and never swap places
+// with an earlier one. The player's distance field is the heuristic, so a
+// search with nobody in the way walks straight down it.
+//
+// Paths are kept from one call to the next. An enemy only searches again
+// when its path is down to half a window. Everyone replans when the player
+// or a box moves, or when the enemies are not where their paths said.
+class CooperativePlanner {
+public:
+    static const int kWindow = 8;
+
+    CooperativePlanner();
+
+    // Where each enemy should be after this tick. No two enemies end on one
+    // tile and no pair swaps places.
+    std::vector<Point> plan(const GameState& state);
+    // Once `flag` is set, plan() stops searching and keeps every enemy where
+    // it is. Null clears it.
+    void setCancelFlag(const std::atomic<bool>* flag);
+
+    // Windowed searches run by the last plan() call, and the nodes they expanded
+    int searches() const;
+    unsigned expansions() const;
+
+private:
+    // Open-addressed map from (tick, cell) keys to an int, emptied in O(1)
+    // by moving to a new generation
+    class SlotMap {
+    public:
+        SlotMap();
+        void clear();
+        const int* find(std::uint64_t key) const;
+        // Inserts or overwrites
+        void set(std::uint64_t key, int value);
+
+    private:
+        size_t slot(std::uint64_t key) const;
+        void grow();
+
+        std::vector<std::uint64_t> keys;
+        std::vector<int> values;
+        std::vector<unsigned> stamps;
+        unsigned generation;
+        size_t used;
+    };
+
+    struct Node {
+        int cell;
+        int tick;
+        int parent;
+    };
+
+    bool stillValid(const GameState& state) const;
+    void reserve(int enemy);
+    void release(int enemy);
+    int reservedBy(int cell, int tick) const;
+    void search(const GameState& state, int enemy);
+    int estimate(const GameState& state, int cell) const;
+    std::uint64_t key(int cell, int tick) const;
+
+    int w;
+    int h;
+    int player;
+    Bitboard boxes;
+    // Cells from each enemy's position now, one per tick; the last one is
+    // held for the rest of the window
+    std::vector<std::vector<int>> paths;
+    SlotMap reservations;
+    std::vector<int> order;
+
+    SlotMap visited;
+    std::vector<Node> nodes;
+    std::vector<std::pair<int, int>> open;
+    int searchCount;
+    unsigned expanded;
+    const std::atomic<bool>* cancel;
+};
+
+} // namespace SB
+
+#endif // CooperativePlanner_HPP
@@ -0,0 +1,73 @@
+#include "Deadlock.hpp"
+
+namespace SB {
+
+DeadlockAnalysis::DeadlockAnalysis() : w(0), h(0), offGoal(false) {}
+
+void DeadlockAnalysis::analyze(const std::vector<char>& grid, int width, int height) {
+    w = width;
+    h = height;
+    walls.resize(w * h);
+    goals.resize(w * h);
+    dead.resize(w * h);
+    for (int i = 0; i < w * h; ++i) {
+        walls.assign(i, grid[i] == '#');
+        goals.assign(i, grid[i] == 'a' || grid[i] == '1');
+    }
+
+    // Pull every goal backwards: a box can be pulled from t to t - d when
+    // both t - d and the player's cell t - 2d are free of walls.
+    Bitboard live(w * h);
+    std::vector<int> queue;
+    for (int g = 0; g < w * h; ++g) {
+        if (goals.test(g) && !live.test(g)) {
+            live.set(g);
+            queue.push_back(g);
+        }
+    }
+    const int dirs[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int t = queue[head];
+        for (const auto& d : dirs) {
+            int from = neighbor(t, d[0], d[1]);
+            int stand = from < 0 ? -1 : neighbor(from, d[0], d[1]);
+            if (stand < 0 || walls.test(from) || walls.test(stand) || live.test(from)) continue;
+            live.set(from);
+            queue.push_back(from);
+        }
+    }
+
+    dead.fill();
+    dead.andNot(live);
+    dead.andNot(walls);
+}
+
+bool DeadlockAnalysis::isDeadSquare(int cell) const {
+    return dead.test(cell);
+}
+
+bool DeadlockAnalysis::isGoal(int cell) const {
+    return goals.test(cell);
+}
+
+const Bitboard& DeadlockAnalysis::deadSquares() const {
+    return dead;
+}
+
+int DeadlockAnalysis::liveCount() const {
+    return w * h - walls.count() - dead.count();
+}
+
+int DeadlockAnalysis::neighbor(int cell, int dx, int dy) const {
+    int x = cell % w + dx;
+    int y = cell / w + dy;
+    if (x < 0 || x >= w || y < 0 || y >= h) return -1;
+    return x + y * w;
+}
+
+bool DeadlockAnalysis::solid(int cell) const {
+    return cell < 0 || walls.test(cell) ||
+           std::find(visiting.begin(), visiting.end(), cell) != visiting.end();
+}
+
+} // namespace SB
@@ -0,0 +1,83 @@
+#ifndef Deadlock_HPP
+#define Deadlock_HPP
+
+#include <algorithm>
+#include <vector>
+#include "Bitboard.hpp"
+
+namespace SB {
+
+// Static and dynamic deadlock knowledge for one level.
+//
+// Dead squares are computed once at load: a cell is live only if a box on it
+// could still be pulled there from some goal, so a box pushed onto a dead
+// square can never be stored. Freeze deadlocks are checked per push: a box
+// that can move along neither axis, because of walls, dead squares or other
+// frozen boxes, is stuck for good and is fatal unless it sits on a goal.
+class DeadlockAnalysis {
+public:
+    DeadlockAnalysis();
+
+    void analyze(const std::vector<char>& grid, int width, int height);
+
+    bool isDeadSquare(int cell) const;
+    bool isGoal(int cell) const;
+    const Bitboard& deadSquares() const;
+    int liveCount() const;
+
+    // True if the box just pushed onto `cell` is now part of a frozen group
+    // with at least one box off its goal. `isBox(cell)` reports the current
+    // box layout; only the boxes touching the pushed one are examined.
+    template <typename IsBox>
+    bool isFrozen(int cell, IsBox isBox) const;
+
+private:
+    int neighbor(int cell, int dx, int dy) const;
+    bool solid(int cell) const;
+    template <typename IsBox>
+    bool frozen(int cell, IsBox& isBox) const;
+    template <typename IsBox>
+    bool blockedAlong(int cell, int dx, int dy, IsBox& isBox) const;
+
+    int w;
+    int h;
+    Bitboard walls;
+    Bitboard goals;
+    Bitboard dead;
+    mutable std::vector<int> visiting;
+    mutable bool offGoal;
+};
+
+template <typename IsBox>
+bool DeadlockAnalysis::isFrozen(int cell, IsBox isBox) const {
+    visiting.clear();
+    offGoal = false;
+    return frozen(cell, isBox) && offGoal;
+}
+
+// While a box is being examined it counts as a wall to its neighbours,
+// which both ends the recursion and is exactly the assumption being tested.
+template <typename IsBox>
+bool DeadlockAnalysis::frozen(int cell, IsBox& isBox) const {
+    visiting.push_back(cell);
+    bool stuck = blockedAlong(cell, 1, 0, isBox) && blockedAlong(cell, 0, 1, isBox);
+    if (!stuck) {
+        visiting.erase(std::find(visiting.begin(), visiting.end(), cell));
+    } else if (!goals.test(cell)) {
+        offGoal = true;
+    }
+    return stuck;
+}
+
+template <typename IsBox>
+bool DeadlockAnalysis::blockedAlong(int cell, int dx, int dy, IsBox& isBox) const {
+    int a = neighbor(cell, -dx, -dy);
+    int b = neighbor(cell, dx, dy);
+    if (solid(a) || solid(b)) return true;
+    if (dead.test(a) && dead.test(b)) return true;
+    return (isBox(a) && frozen(a, isBox)) || (isBox(b) && frozen(b, isBox));
+}
+
+} // namespace SB
+
+#endif // Deadlock_HPP
@@ -0,0 +1,438 @@
+#include "EnemyPlanner.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <random>
+
+namespace SB {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int kInfinity = 1 << 28;
+const int kCaught = 1 << 20;
+// Beyond any path, yet small enough that a pack's distances sum safely
+const std::int32_t kUnreached = std::numeric_limits<std::int32_t>::max() / 16;
+// Joint moves grow as choices^ghosts, so each ghost keeps fewer of its best
+// steps as the pack gets larger, and only the most promising joint moves
+// are searched.
+const size_t kMaxJointMoves = 64;
+// Even two choices each is too many joint moves to list for a crowd; larger
+// packs are handed to CooperativePlanner instead.
+const size_t kMaxPlannedGhosts = 8;
+// Memory for cached distance rows, at four bytes a cell; never fewer than
+// kMinDistanceRows rows
+const size_t kDistanceBytes = 32 << 20;
+const size_t kMinDistanceRows = 8;
+
+int choicesPerGhost(int ghosts) {
+    return ghosts <= 2 ? 5 : ghosts <= 4 ? 3 : 2;
+}
+
+// Catch scores are stored relative to the node so that a cached "caught in
+// two plies" stays correct when reached at a different depth.
+int toCache(int value, int ply) {
+    return value > kCaught / 2 ? value + ply : value;
+}
+
+int fromCache(int value, int ply) {
+    return value > kCaught / 2 ? value - ply : value;
+}
+
+}
+
+EnemyPlanner::EnemyPlanner(size_t cacheEntries)
+    : w(0), h(0), ghosts(0), offsets{0, 0, 0, 0}, layout(0), rowClock(0), maxRows(0), searchDepth(0), sideKey(0),
+      player(0),
+      rootBest(0), aborted(false), cancel(nullptr) {
+    size_t size = 1;
+    while (size < cacheEntries) size <<= 1;
+    cache.assign(size, Entry{0, 0, 0, Exact, 0});
+    mask = size - 1;
+}
+
+const PlannerStats& EnemyPlanner::stats() const {
+    return last;
+}
+
+void EnemyPlanner::setCancelFlag(const std::atomic<bool>* flag) {
+    cancel = flag;
+    crowd.setCancelFlag(flag);
+}
+
+int EnemyPlanner::neighbor(int cell, int dir) const {
+    int x = cell % w;
+    int y = cell / w;
+    if ((dir == Up && y == 0) || (dir == Down && y == h - 1) ||
+        (dir == Left && x == 0) || (dir == Right && x == w - 1)) return -1;
+    return cell + offsets[dir];
+}
+
+// Distance tables depend only on walls and boxes, so they, the Zobrist keys
+// and the cache survive from tick to tick until a box is pushed.
+void EnemyPlanner::prepare(const GameState& state) {
+    int count = static_cast<int>(state.enemyLocs().size());
+    if (state.width() != w || state.height() != h || count != ghosts || state.layoutVersion() != layout) {
+        w = state.width();
+        h = state.height();
+        ghosts = count;
+        layout = state.layoutVersion();
+        offsets[Up] = -w;
+        offsets[Down] = w;
+        offsets[Left] = -1;
+        offsets[Right] = 1;
+        int cells = w * h;
+        const Occupancy& occ = state.occupancy();
+        open.resize(cells);
+        for (int i = 0; i < cells; ++i) {
+            open[i] = !occ.solid(i);
+        }
+        rowOf.assign(cells, -1);
+        rows.clear();
+        rowReach.clear();
+        rowTouched.clear();
+        rowCell.clear();
+        rowUsed.clear();
+        target.assign(cells, 0);
+        maxRows = std::max(kMinDistanceRows, kDistanceBytes / (sizeof(std::int32_t) * std::max(cells, 1)));
+
+        std::mt19937_64 rng(0x5eed);
+        playerKeys.resize(cells);
+        for (auto& key : playerKeys) key = rng();
+        enemyKeys.resize(static_cast<size_t>(cells) * ghosts);
+        for (auto& key : enemyKeys) key = rng();
+        sideKey = rng();
+        std::fill(cache.begin(), cache.end(), Entry{0, 0, 0, Exact, 0});
+    }
+
+    player = state.getArrayIndex(state.playerLoc().x, state.playerLoc().y);
+    enemies.clear();
+    for (const Point& e : state.enemyLocs()) {
+        enemies.push_back(state.getArrayIndex(e.x, e.y));
+    }
+}
+
+// Whether a row still holds exact distances to every enemy and the tiles
+// next to it
+bool EnemyPlanner::covers(int slot) const {
+    if (rowReach[slot] == kUnreached) return true;
+    const std::vector<std::int32_t>& row = rows[slot];
+    for (int e : enemies) {
+        if (row[e] >= rowReach[slot]) return false;
+    }
+    return true;
+}
+
+// The row returned stays valid until the next call. The search breadth
+// first stops searchDepth + 2 steps past the furthest enemy: the player
+// and enemies stay that close to where they were while one plan runs, and
+// a row that no longer covers the enemies is simply searched again.
+const std::int32_t* EnemyPlanner::distancesFrom(int cell) {
+    int slot = rowOf[cell];
+    if (slot >= 0 && covers(slot)) {
+        rowUsed[slot] = ++rowClock;
+        return rows[slot].data();
+    }
+    if (slot < 0 && rows.size() < maxRows) {
+        slot = static_cast<int>(rows.size());
+        rows.emplace_back();
+        rowReach.push_back(kUnreached);
+        rowTouched.emplace_back();
+        rowCell.push_back(cell);
+        rowUsed.push_back(0);
+    } else if (slot < 0) {
+        slot = static_cast<int>(std::min_element(rowUsed.begin(), rowUsed.end()) - rowUsed.begin());
+        rowOf[rowCell[slot]] = -1;
+        rowCell[slot] = cell;
+    }
+    rowOf[cell] = slot;
+    rowUsed[slot] = ++rowClock;
+
+    std::vector<std::int32_t>& row = rows[slot];
+    if (row.empty() || rowReach[slot] == kUnreached) {
+        row.assign(w * h, kUnreached);
+    } else {
+        for (int touched : rowTouched[slot]) row[touched] = kUnreached;
+    }
+
+    int pending = 0;
+    for (int e : enemies) {
+        if (!target[e]) {
+            target[e] = 1;
+            ++pending;
+        }
+    }
+    std::int32_t reach = kUnreached;
+    auto arrive = [&](int next, std::int32_t distance) {
+        row[next] = distance;
+        queue.push_back(next);
+        if (target[next]) {
+            target[next] = 0;
+            if (--pending == 0) reach = distance + searchDepth + 2;
+        }
+    };
+    queue.clear();
+    arrive(cell, 0);
+    size_t head = 0;
+    for (; head < queue.size(); ++head) {
+        int current = queue[head];
+        if (row[current] >= reach) break;
+        for (int dir = 0; dir < 4; ++dir) {
+            int next = neighbor(current, dir);
+            if (next < 0 || !open[next] || row[next] != kUnreached) continue;
+            arrive(next, row[current] + 1);
+        }
+    }
+    for (int e : enemies) target[e] = 0;
+
+    if (head < queue.size()) {
+        rowReach[slot] = reach;
+        rowTouched[slot] = queue;
+    } else {
+        rowReach[slot] = kUnreached;
+        rowTouched[slot].clear();
+    }
+    return row.data();
+}
+
+std::uint64_t EnemyPlanner::hash(bool enemiesToMove) const {
+    std::uint64_t key = playerKeys[player];
+    for (int i = 0; i < ghosts; ++i) {
+        key ^= enemyKeys[static_cast<size_t>(i) * w * h + enemies[i]];
+    }
+    return enemiesToMove ? key : key ^ sideKey;
+}
+
+int EnemyPlanner::evaluate() {
+    const std::int32_t* d = distancesFrom(player);
+    int far = w * h;
+    int nearest = far;
+    int total = 0;
+    for (int e : enemies) {
+        int distance = d[e] == kUnreached ? far : d[e];
+        nearest = std::min(nearest, distance);
+        total += distance;
+    }
+
+    int escapes = 0;
+    for (int dir = 0; dir < 4; ++dir) {
+        int next = neighbor(player, dir);
+        if (next < 0 || !open[next]) continue;
+        bool safe = true;
+        for (int e : enemies) {
+            if (std::abs(e % w - next % w) + std::abs(e / w - next / w) <= 1) safe = false;
+        }
+        escapes += safe;
+    }
+    return -(4 * nearest + total) - 3 * escapes;
+}
+
+// Every enemy stays or steps to an open neighbour; no two end on one tile
+// and no pair swaps places. Joint moves come out closest-to-player first.
+void EnemyPlanner::enemyMoves(int ply) {
+    const std::int32_t* d = distancesFrom(player);
+    int keep = choicesPerGhost(ghosts);
+    options.assign(static_cast<size_t>(ghosts) * 5, 0);
+    counts.assign(ghosts, 0);
+    for (int g = 0; g < ghosts; ++g) {
+        order.clear();
+        order.emplace_back(d[enemies[g]], enemies[g]);
+        for (int dir = 0; dir < 4; ++dir) {
+            int next = neighbor(enemies[g], dir);
+            if (next >= 0 && open[next]) order.emplace_back(d[next], next);
+        }
+        std::stable_sort(order.begin(), order.end());
+        counts[g] = std::min<int>(keep, static_cast<int>(order.size()));
+        for (int k = 0; k < counts[g]; ++k) {
+            options[g * 5 + k] = order[k].second;
+        }
+    }
+
+    scratch.clear();
+    order.clear();
+    pick.assign(ghosts, 0);
+    while (true) {
+        bool valid = true;
+        for (int i = 0; i < ghosts && valid; ++i) {
+            int ti = options[i * 5 + pick[i]];
+            for (int j = i + 1; j < ghosts && valid; ++j) {
+                int tj = options[j * 5 + pick[j]];
+                if (ti == tj || (ti == enemies[j] && tj == enemies[i])) valid = false;
+            }
+        }
+        if (valid) {
+            int score = 0;
+            for (int i = 0; i < ghosts; ++i) {
+                int t = options[i * 5 + pick[i]];
+                scratch.push_back(t);
+                score += d[t];
+            }
+            order.emplace_back(score, static_cast<int>(order.size()));
+        }
+
+        int g = 0;
+        while (g < ghosts && ++pick[g] == counts[g]) pick[g++] = 0;
+        if (g == ghosts) break;
+    }
+
+    std::stable_sort(order.begin(), order.end());
+    if (order.size() > kMaxJointMoves) order.resize(kMaxJointMoves);
+    std::vector<int>& out = jointMoves[ply];
+    out.clear();
+    for (const auto& entry : order) {
+        out.insert(out.end(), scratch.begin() + entry.second * ghosts,
+                   scratch.begin() + (entry.second + 1) * ghosts);
+    }
+}
+
+// The player may stay or step to an open neighbour, furthest from the
+// nearest enemy first.
+void EnemyPlanner::playerMoves(int ply) {
+    order.clear();
+    for (int dir = -1; dir < 4; ++dir) {
+        int next = dir < 0 ? player : neighbor(player, dir);
+        if (next < 0 || !open[next]) continue;
+        const std::int32_t* d = distancesFrom(next);
+        int nearest = kUnreached;
+        for (int e : enemies) nearest = std::min<int>(nearest, d[e]);
+        order.emplace_back(-nearest, next);
+    }
+    std::stable_sort(order.begin(), order.end());
+    std::vector<int>& out = replies[ply];
+    out.clear();
+    for (const auto& entry : order) out.push_back(entry.second);
+}
+
+int EnemyPlanner::search(int depth, int alpha, int beta, bool enemiesToMove, int ply) {
+    ++last.nodes;
+    for (int e : enemies) {
+        if (e == player) return kCaught - ply;
+    }
+    if (depth == 0) return evaluate();
+    if ((last.nodes & 15) == 0 && (Clock::now() >= deadline || (cancel && cancel->load(std::memory_order_relaxed)))) {
+        aborted = true;
+    }
+    if (aborted) return 0;
+
+    std::uint64_t key = hash(enemiesToMove);
+    Entry& slot = cache[key & mask];
+    int hint = -1;
+    if (slot.key == key) {
+        hint = slot.best;
+        if (ply > 0 && slot.depth >= depth) {
+            int cached = fromCache(slot.value, ply);
+            if (slot.bound == Exact) return cached;
+            if (slot.bound == Lower && cached >= beta) return cached;
+            if (slot.bound == Upper && cached <= alpha) return cached;
+        }
+    }
+
+    int alphaIn = alpha;
+    int betaIn = beta;
+    int bestIndex = 0;
+    int value;
+    if (enemiesToMove) {
+        enemyMoves(ply);
+        const std::vector<int>& moves = jointMoves[ply];
+        int count = static_cast<int>(moves.size()) / ghosts;
+        if (hint >= count) hint = -1;
+        std::copy(enemies.begin(), enemies.end(), saved.begin() + ply * ghosts);
+
+        value = -kInfinity;
+        for (int k = 0; k < count; ++k) {
+            // The cached best move goes first, the rest keep their order
+            int i = hint < 0 ? k : k == 0 ? hint : k <= hint ? k - 1 : k;
+            std::copy(moves.begin() + i * ghosts, moves.begin() + (i + 1) * ghosts, enemies.begin());
+            int v = search(depth - 1, alpha, beta, false, ply + 1);
+            std::copy(saved.begin() + ply * ghosts, saved.begin() + (ply + 1) * ghosts, enemies.begin());
+            if (aborted) return 0;
+            if (v > value) {
+                value = v;
+                bestIndex = i;
+            }
+            alpha = std::max(alpha, value);
+            if (alpha >= beta) break;
+        }
+    } else {
+        playerMoves(ply);
+        const std::vector<int>& moves = replies[ply];
+        int count = static_cast<int>(moves.size());
+        if (hint >= count) hint = -1;
+        int from = player;
+
+        value = kInfinity;
+        for (int k = 0; k < count; ++k) {
+            int i = hint < 0 ? k : k == 0 ? hint : k <= hint ? k - 1 : k;
+            player = moves[i];
+            int v = search(depth - 1, alpha, beta, true, ply + 1);
+            player = from;
+            if (aborted) return 0;
+            if (v < value) {
+                value = v;
+                bestIndex = i;
+            }
+            beta = std::min(beta, value);
+            if (alpha >= beta) break;
+        }
+    }
+
+    if (ply == 0) rootBest = bestIndex;
+    if (slot.key != key || slot.depth <= depth) {
+        Bound bound = value <= alphaIn ? Upper : value >= betaIn ? Lower : Exact;
+        slot = Entry{key, toCache(value, ply), static_cast<std::int16_t>(depth), bound,
+                     static_cast<std::uint16_t>(bestIndex)};
+    }
+    return value;
+}
+
+std::vector<Point> EnemyPlanner::plan(const GameState& state, double budgetSeconds, int maxDepth) {
+    SB_PROFILE_SCOPE("planEnemies");
+    Clock::time_point start = Clock::now();
+    deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(budgetSeconds));
+    if (state.enemyLocs().size() > kMaxPlannedGhosts) {
+        last = PlannerStats();
+        std::vector<Point> moves = crowd.plan(state);
+        last.nodes = crowd.expansions();
+        last.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return moves;
+    }
+    prepare(state);
+    last = PlannerStats();
+    aborted = false;
+    searchDepth = maxDepth;
+    if (ghosts == 0 || state.isGameOver()) return state.enemyLocs();
+
+    jointMoves.resize(maxDepth + 1);
+    replies.resize(maxDepth + 1);
+    saved.assign(static_cast<size_t>(maxDepth + 1) * ghosts, 0);
+
+    std::vector<int> chosen;
+    for (int depth = 1; depth <= maxDepth; ++depth) {
+        rootBest = 0;
+        int value = search(depth, -kInfinity, kInfinity, true, 0);
+        if (aborted) break;
+        const std::vector<int>& moves = jointMoves[0];
+        chosen.assign(moves.begin() + rootBest * ghosts, moves.begin() + (rootBest + 1) * ghosts);
+        last.depth = depth;
+        last.score = value;
+        if (value > kCaught / 2) break;
+    }
+    // Out of time before even one ply: take the closest joint move
+    if (chosen.empty()) {
+        enemyMoves(0);
+        chosen.assign(jointMoves[0].begin(), jointMoves[0].begin() + ghosts);
+    }
+
+    std::vector<Point> locs;
+    for (int cell : chosen) {
+        locs.push_back(Point{cell % w, cell / w});
+    }
+    last.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    SB_PROFILE_COUNT(PlannerNodes, last.nodes);
+    return locs;
+}
+
+} // namespace SB
@@ -0,0 +1,112 @@
+#ifndef EnemyPlanner_HPP
+#define EnemyPlanner_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "CooperativePlanner.hpp"
+#include "GameState.hpp"
+
+namespace SB {
+
+struct PlannerStats {
+    int depth = 0;            // plies fully searched
+    std::uint64_t nodes = 0;
+    double seconds = 0;
+    int score = 0;            // enemies' view; positive means closing in
+};
+
+// Alpha-beta search over joint enemy moves against player replies, deepened
+// one ply at a time until the time budget runs out. Boxes are taken as
+// fixed for the length of the search. The score rewards catching the player
+// soon, being close in maze distance and leaving the player few safe tiles
+// to step to. Results are cached by position across calls until the walls
+// or boxes change. Packs too large for a joint search are planned one enemy
+// at a time by a CooperativePlanner.
+class EnemyPlanner {
+public:
+    explicit EnemyPlanner(size_t cacheEntries = 1 << 16);
+
+    // Where each enemy should be after this tick: its own tile or a
+    // neighbouring one, never two enemies on one tile.
+    std::vector<Point> plan(const GameState& state, double budgetSeconds = 0.02, int maxDepth = 16);
+    const PlannerStats& stats() const;
+    // A search, a crowd's included, stops as if out of time once `flag` is
+    // set. Null clears it.
+    void setCancelFlag(const std::atomic<bool>* flag);
+
+private:
+    enum Bound : std::uint8_t { Exact, Lower, Upper };
+
+    struct Entry {
+        std::uint64_t key;
+        std::int32_t value;
+        std::int16_t depth;
+        Bound bound;
+        std::uint16_t best;
+    };
+
+    void prepare(const GameState& state);
+    const std::int32_t* distancesFrom(int cell);
+    bool covers(int slot) const;
+    std::uint64_t hash(bool enemiesToMove) const;
+    int evaluate();
+    int search(int depth, int alpha, int beta, bool enemiesToMove, int ply);
+    void enemyMoves(int ply);
+    void playerMoves(int ply);
+    int neighbor(int cell, int dir) const;
+
+    int w;
+    int h;
+    int ghosts;
+    int offsets[4];
+    std::uint64_t layout;
+    std::vector<char> open;
+    // Distances from the player cells searched lately, least recently used
+    // dropped first once maxRows are held. A row is filled only out to
+    // rowReach, far enough past the enemies for the search's depth, and
+    // names the cells it filled in rowTouched so it can be cleared cheaply.
+    std::vector<int> rowOf;
+    std::vector<std::vector<std::int32_t>> rows;
+    std::vector<std::int32_t> rowReach;
+    std::vector<std::vector<int>> rowTouched;
+    std::vector<int> rowCell;
+    std::vector<std::uint64_t> rowUsed;
+    std::uint64_t rowClock;
+    size_t maxRows;
+    std::vector<int> queue;
+    std::vector<char> target;
+    int searchDepth;
+    std::vector<std::uint64_t> playerKeys;
+    std::vector<std::uint64_t> enemyKeys;
+    std::uint64_t sideKey;
+
+    std::vector<Entry> cache;
+    size_t mask;
+
+    int player;
+    std::vector<int> enemies;
+    // Per ply: candidate moves, flattened `ghosts` cells per joint move
+    std::vector<std::vector<int>> jointMoves;
+    std::vector<std::vector<int>> replies;
+    std::vector<int> saved;
+    std::vector<std::pair<int, int>> order;
+    std::vector<int> options;
+    std::vector<int> counts;
+    std::vector<int> pick;
+    std::vector<int> scratch;
+
+    CooperativePlanner crowd;
+
+    std::vector<int> rootMoves;
+    int rootBest;
+    bool aborted;
+    const std::atomic<bool>* cancel;
+    std::chrono::steady_clock::time_point deadline;
+    PlannerStats last;
+};
+
+} // namespace SB
+
+#endif // EnemyPlanner_HPP
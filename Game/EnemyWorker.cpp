@@ -0,0 +1,125 @@
+#include "EnemyWorker.hpp"
+
+#include <utility>
+
+namespace SB {
+
+EnemyWorker::EnemyWorker(double budgetSeconds)
+    : budget(budgetSeconds), pendingGeneration(0), hasPending(false), stopping(false), cancelled(false),
+      sentLayout(0), workingLayout(0), latest(0), back(1), front(2) {
+    planner.setCancelFlag(&cancelled);
+    thread = std::thread([this] { run(); });
+}
+
+EnemyWorker::~EnemyWorker() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+        cancelled.store(true, std::memory_order_relaxed);
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+// Only the tiles scale with the map, and they are copied outside the lock
+// and only after a push
+void EnemyWorker::request(const GameState& state, std::uint64_t generation) {
+    std::vector<char> tiles;
+    bool relayout = state.layoutVersion() != sentLayout;
+    if (relayout) {
+        tiles = state.tiles();
+        sentLayout = state.layoutVersion();
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (relayout) {
+            pending.layout = sentLayout;
+            pending.width = state.width();
+            pending.height = state.height();
+            pending.tiles.swap(tiles);
+        }
+        pending.player = state.playerLoc();
+        pending.enemies = state.enemyLocs();
+        pendingGeneration = generation;
+        hasPending = true;
+        cancelled.store(true, std::memory_order_relaxed);
+    }
+    wake.notify_one();
+}
+
+bool EnemyWorker::take(std::uint64_t generation, std::vector<Point>& locs) {
+    if (latest.load(std::memory_order_relaxed) & kFresh) {
+        front = latest.exchange(front, std::memory_order_acq_rel) & ~kFresh;
+    }
+    if (plans[front].generation != generation) return false;
+    locs = plans[front].locs;
+    return true;
+}
+
+void EnemyWorker::run() {
+    while (true) {
+        std::uint64_t generation;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return hasPending || stopping; });
+            if (stopping) return;
+            taken.player = pending.player;
+            taken.enemies.swap(pending.enemies);
+            if (!pending.tiles.empty()) {
+                taken.layout = pending.layout;
+                taken.width = pending.width;
+                taken.height = pending.height;
+                taken.tiles.swap(pending.tiles);
+                pending.tiles.clear();
+            }
+            generation = pendingGeneration;
+            hasPending = false;
+            cancelled.store(false, std::memory_order_relaxed);
+        }
+
+        if (taken.layout != workingLayout && !patchLayout()) {
+            working.load(taken.width, taken.height, std::move(taken.tiles), taken.player, taken.enemies);
+        } else {
+            working.setPlayerLoc(taken.player);
+            working.setEnemyLocs(taken.enemies);
+        }
+        taken.tiles.clear();
+        workingLayout = taken.layout;
+        if (cancelled.load(std::memory_order_relaxed)) continue;
+
+        working.settleField();
+        std::vector<Point> locs = planner.plan(working, budget);
+        // Superseded while searching: the result is for a state that is gone
+        if (cancelled.load(std::memory_order_relaxed)) continue;
+
+        plans[back].generation = generation;
+        plans[back].locs.swap(locs);
+        back = latest.exchange(back | kFresh, std::memory_order_acq_rel) & ~kFresh;
+    }
+}
+
+// Pushes and undos only move boxes, so the working copy follows them box by
+// box and keeps its clusters, jump tables and landmarks, which load() would
+// build again from nothing. Anything else, such as another level, is not
+// patched.
+bool EnemyWorker::patchLayout() {
+    if (workingLayout == 0 || taken.width != working.width() || taken.height != working.height() ||
+        taken.enemies.size() != working.enemyLocs().size()) return false;
+    auto isBox = [](char c) { return c == 'A' || c == '1'; };
+    auto isGoal = [](char c) { return c == 'a' || c == '1'; };
+    const std::vector<char>& have = working.tiles();
+    std::vector<int> emptied;
+    std::vector<int> filled;
+    for (size_t i = 0; i < have.size(); ++i) {
+        char from = have[i];
+        char to = taken.tiles[i];
+        if ((from == '#') != (to == '#') || isGoal(from) != isGoal(to)) return false;
+        if (isBox(from) && !isBox(to)) emptied.push_back(static_cast<int>(i));
+        else if (!isBox(from) && isBox(to)) filled.push_back(static_cast<int>(i));
+    }
+    if (emptied.size() != filled.size()) return false;
+    for (size_t i = 0; i < emptied.size(); ++i) working.moveBox(emptied[i], filled[i]);
+    return true;
+}
+
+} // namespace SB
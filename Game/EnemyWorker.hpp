@@ -0,0 +1,89 @@
+#ifndef EnemyWorker_HPP
+#define EnemyWorker_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "EnemyPlanner.hpp"
+#include "GameState.hpp"
+
+namespace SB {
+
+// Runs EnemyPlanner on a thread of its own. Each request hands over the
+// actors' cells, plus the tiles when a box has moved since the last one; the
+// worker keeps its own copy of the level up to date from them, moving its
+// boxes rather than loading the level again, and plans from that while the
+// caller keeps playing and drawing. A newer request cancels the plan still
+// running for an older one, mid-search, and the worker always moves on to
+// the newest request.
+//
+// Finished plans come back through three slots: the worker fills one, the
+// caller reads another, and the third holds the latest finished plan. The
+// two sides only ever exchange slot indices with one atomic, so neither
+// waits on the other.
+class EnemyWorker {
+public:
+    explicit EnemyWorker(double budgetSeconds = 0.05);
+    ~EnemyWorker();
+    EnemyWorker(const EnemyWorker&) = delete;
+    EnemyWorker& operator=(const EnemyWorker&) = delete;
+
+    // Plans from `state`, tagged with `generation`, which should grow with
+    // every call.
+    void request(const GameState& state, std::uint64_t generation);
+    // The enemies' next cells planned for `generation`, if that plan has
+    // finished.
+    bool take(std::uint64_t generation, std::vector<Point>& locs);
+
+private:
+    // What the worker needs to catch its level up with the caller's
+    struct Snapshot {
+        std::uint64_t layout = 0;   // GameState::layoutVersion() of `tiles`
+        int width = 0;
+        int height = 0;
+        std::vector<char> tiles;    // empty unless the layout changed
+        Point player{-1, -1};
+        std::vector<Point> enemies;
+    };
+
+    struct Plan {
+        std::uint64_t generation = 0;
+        std::vector<Point> locs;
+    };
+
+    static const unsigned kFresh = 4;
+
+    void run();
+    bool patchLayout();
+
+    double budget;
+    EnemyPlanner planner;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    Snapshot pending;
+    std::uint64_t pendingGeneration;
+    bool hasPending;
+    bool stopping;
+    std::atomic<bool> cancelled;
+    std::uint64_t sentLayout;   // caller side: last layout handed over
+
+    Snapshot taken;
+    GameState working;
+    std::uint64_t workingLayout;
+
+    Plan plans[3];
+    // Slot index of the latest plan, plus kFresh until the caller takes it
+    std::atomic<unsigned> latest;
+    unsigned back;   // worker's slot
+    unsigned front;  // caller's slot
+
+    std::thread thread;
+};
+
+} // namespace SB
+
+#endif // EnemyWorker_HPP
@@ -0,0 +1,109 @@
+#include "FlowField.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace SB {
+
+FlowField::FlowField() : w(0), h(0), src(-1), generation(0), head(0) {}
+
+bool FlowField::isObstacle(char tile) {
+    return tile == '#' || tile == 'A' || tile == '1';
+}
+
+void FlowField::build(const std::vector<char>& grid, int width, int height, int source) {
+    w = width;
+    h = height;
+    src = source;
+    walls.resize(w * h);
+    for (int i = 0; i < w * h; ++i) {
+        walls[i] = isObstacle(grid[i]);
+    }
+    dist.assign(w * h, kUnreachable);
+    stamp.assign(w * h, 0);
+    generation = 0;
+    queue.clear();
+    queue.reserve(w * h);
+    restart();
+}
+
+int FlowField::source() const {
+    return src;
+}
+
+int FlowField::distance(int cell) {
+    if (cell < 0 || cell >= w * h) return kUnreachable;
+    if (stamp[cell] != generation) expand(cell);
+    return stamp[cell] == generation ? dist[cell] : kUnreachable;
+}
+
+int FlowField::distance(int cell) const {
+    if (cell < 0 || cell >= w * h) return kUnreachable;
+    assert(stamp[cell] == generation || settled());
+    return stamp[cell] == generation ? dist[cell] : kUnreachable;
+}
+
+void FlowField::settle() {
+    expand(-1);
+}
+
+bool FlowField::settled() const {
+    return head >= queue.size();
+}
+
+bool FlowField::blocked(int cell) const {
+    return walls[cell];
+}
+
+int FlowField::neighbors(int cell, int out[4]) const {
+    int n = 0;
+    int x = cell % w;
+    if (x + 1 < w && !walls[cell + 1]) out[n++] = cell + 1;
+    if (x > 0 && !walls[cell - 1]) out[n++] = cell - 1;
+    if (cell + w < w * h && !walls[cell + w]) out[n++] = cell + w;
+    if (cell - w >= 0 && !walls[cell - w]) out[n++] = cell - w;
+    return n;
+}
+
+void FlowField::restart() {
+    if (++generation == 0) {
+        std::fill(stamp.begin(), stamp.end(), 0);
+        generation = 1;
+    }
+    queue.clear();
+    head = 0;
+    if (src < 0 || src >= w * h || walls[src]) return;
+    stamp[src] = generation;
+    dist[src] = 0;
+    queue.push_back(src);
+}
+
+// A FIFO wave hands out distances in order, so a tile's first distance is
+// final and the wave can stop anywhere and pick up again later.
+void FlowField::expand(int cell) {
+    int adj[4];
+    while (head < queue.size() && (cell < 0 || stamp[cell] != generation)) {
+        int v = queue[head++];
+        int n = neighbors(v, adj);
+        for (int i = 0; i < n; ++i) {
+            if (stamp[adj[i]] == generation) continue;
+            stamp[adj[i]] = generation;
+            dist[adj[i]] = dist[v] + 1;
+            queue.push_back(adj[i]);
+        }
+    }
+}
+
+void FlowField::moveSource(int cell) {
+    if (cell == src) return;
+    src = cell;
+    restart();
+}
+
+void FlowField::setBlocked(int cell, bool isBlocked) {
+    if (walls[cell] == isBlocked) return;
+    walls[cell] = isBlocked;
+    restart();
+}
+
+} // namespace SB
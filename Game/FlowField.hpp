@@ -0,0 +1,82 @@
+#ifndef FlowField_HPP
+#define FlowField_HPP
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace SB {
+
+// Distance field over the level grid, measured from a single source tile
+// (the player). The BFS behind it runs lazily: moving the source or
+// (un)blocking a tile only starts it over, and the non-const distance()
+// expands it just far enough to answer. Enemies read the field around
+// themselves, so on a big map a player step costs O(1) and an enemy tick
+// only pays for the ball that reaches the furthest enemy, not for the whole
+// map.
+//
+// Only the owner's thread may expand the field. The const distance() never
+// writes and needs a settled field, so the owner calls settle() before it
+// hands the field, or a copy of it, to const readers or other threads.
+class FlowField {
+public:
+    static constexpr int kUnreachable = std::numeric_limits<int>::max();
+
+    FlowField();
+
+    void build(const std::vector<char>& grid, int width, int height, int source);
+    void moveSource(int cell);
+    void setBlocked(int cell, bool isBlocked);
+    // Runs the BFS to the end, after which every const read is answered
+    void settle();
+    bool settled() const;
+
+    int source() const;
+    // Expands the BFS as far as `cell` if it has not got there yet
+    int distance(int cell);
+    // Read-only lookup on a settled field
+    int distance(int cell) const;
+    bool blocked(int cell) const;
+
+    // Neighbour of `cell` one step closer to the source that `occupied`
+    // does not reject, or `cell` itself if there is none.
+    template <typename Occupied>
+    int descend(int cell, Occupied occupied);
+
+    static bool isObstacle(char tile);
+
+private:
+    int neighbors(int cell, int out[4]) const;
+    // Starts the BFS over from the source, with nothing expanded yet
+    void restart();
+    // Expands the BFS until `cell` has its distance, or to the end for -1
+    void expand(int cell);
+
+    int w;
+    int h;
+    int src;
+    std::vector<char> walls;
+    // dist[i] holds only if stamp[i] is the current generation
+    std::vector<int> dist;
+    std::vector<unsigned> stamp;
+    unsigned generation;
+    std::vector<int> queue;
+    std::size_t head;
+};
+
+template <typename Occupied>
+int FlowField::descend(int cell, Occupied occupied) {
+    int d = distance(cell);
+    if (d == kUnreachable || d == 0) return cell;
+
+    int adj[4];
+    int n = neighbors(cell, adj);
+    for (int i = 0; i < n; ++i) {
+        if (distance(adj[i]) == d - 1 && !occupied(adj[i])) return adj[i];
+    }
+    return cell;
+}
+
+} // namespace SB
+
+#endif // FlowField_HPP
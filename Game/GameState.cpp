@@ -0,0 +1,421 @@
+#include "GameState.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <utility>
+
+namespace SB {
+
+namespace {
+
+// Maps at least this large route findPathAStar through the cluster graph
+const int kClusteredArea = 128 * 128;
+// Landmarks are only built for grid A*, i.e. below kClusteredArea
+const int kLandmarks = 8;
+
+std::atomic<std::uint64_t> nextLayout{1};
+
+}
+
+GameState::GameState() : h(0), w(0), player{-1, -1}, heading(Down), unplaced(0), openGoals(0), placed(0),
+                         everyBoxNeeded(false), stuck(false), layout(0), method(PathMethod::AStar),
+                         useLandmarks(true) {}
+
+int GameState::height() const {
+    return h;
+}
+
+int GameState::width() const {
+    return w;
+}
+
+Point GameState::playerLoc() const {
+    return player;
+}
+
+const std::vector<Point>& GameState::enemyLocs() const {
+    return enemies;
+}
+
+Direction GameState::playerFacing() const {
+    return heading;
+}
+
+Direction GameState::enemyFacing(size_t enemy) const {
+    return facing[enemy];
+}
+
+const std::vector<char>& GameState::tiles() const {
+    return gameMatrix;
+}
+
+char GameState::tile(int x, int y) const {
+    return gameMatrix[getArrayIndex(x, y)];
+}
+
+Point GameState::offset(Direction direction) {
+    switch (direction) {
+        case Up: return Point{0, -1};
+        case Down: return Point{0, 1};
+        case Left: return Point{-1, 0};
+        default: return Point{1, 0};
+    }
+}
+
+bool GameState::step(Direction direction) {
+    heading = direction;
+    int dx = offset(direction).x;
+    int dy = offset(direction).y;
+
+    int newX = player.x + dx;
+    int newY = player.y + dy;
+    int boxX = newX + dx;
+    int boxY = newY + dy;
+    if (newX < 0 || newX >= w || newY < 0 || newY >= h) return false;
+
+    int next = getArrayIndex(newX, newY);
+    if (!occ.solid(next)) {
+        player = {newX, newY};
+        field.moveSource(next);
+        return true;
+    }
+    if (occ.wall(next)) return false;
+
+    // Pushing a box: the tile behind it must be free and ghost-free
+    if (boxX < 0 || boxX >= w || boxY < 0 || boxY >= h) return false;
+    int beyond = getArrayIndex(boxX, boxY);
+    if (occ.solid(beyond) || occ.enemy(beyond)) return false;
+
+    shiftBox(next, beyond);
+    if (everyBoxNeeded && !stuck) {
+        stuck = deadlock.isDeadSquare(beyond) ||
+                deadlock.isFrozen(beyond, [this](int cell) { return occ.box(cell); });
+    }
+
+    player = {newX, newY};
+    field.moveSource(next);
+    return true;
+}
+
+// Every ghost chases the same target, so they all share the player's
+// distance field and just step to a neighbour one tile closer.
+void GameState::tickEnemies() {
+    SB_PROFILE_SCOPE("tickEnemies");
+    for (size_t i = 0; i < enemies.size(); ++i) {
+        Point current = enemies[i];
+        int from = getArrayIndex(current.x, current.y);
+        int to = field.descend(from, [this](int cell) { return occ.enemy(cell); });
+        if (to == from) continue;
+
+        Point next{to % w, to / w};
+        if (next.x > current.x) facing[i] = Right;
+        else if (next.x < current.x) facing[i] = Left;
+        else if (next.y > current.y) facing[i] = Down;
+        else facing[i] = Up;
+
+        enemies[i] = next;
+        occ.moveEnemy(from, to);
+    }
+}
+
+void GameState::undoStep(Direction direction, bool pushed, Direction facing) {
+    heading = facing;
+    int dx = offset(direction).x;
+    int dy = offset(direction).y;
+
+    int here = getArrayIndex(player.x, player.y);
+    player = {player.x - dx, player.y - dy};
+    field.moveSource(getArrayIndex(player.x, player.y));
+    if (!pushed) return;
+
+    shiftBox(getArrayIndex(player.x + 2 * dx, player.y + 2 * dy), here);
+    refreshDeadlock();
+}
+
+void GameState::moveBox(int from, int to) {
+    shiftBox(from, to);
+    refreshDeadlock();
+}
+
+// Patches every structure that treats boxes as obstacles instead of
+// rebuilding it
+void GameState::shiftBox(int from, int to) {
+    setTile(to, (gameMatrix[to] == 'a') ? '1' : 'A');
+    setTile(from, (gameMatrix[from] == '1') ? 'a' : '.');
+    occ.moveBox(from, to);
+    touchLayout();
+    field.setBlocked(to, true);
+    field.setBlocked(from, false);
+    clusters.setBlocked(to, true);
+    clusters.setBlocked(from, false);
+    jumps.setBlocked(to, true);
+    jumps.setBlocked(from, false);
+    alt.setBlocked(to, true);
+    alt.setBlocked(from, false);
+}
+
+// Enemies may move into tiles other enemies are leaving in the same tick, so
+// the enemy plane is rebuilt rather than updated one move at a time.
+void GameState::setEnemyLocs(const std::vector<Point>& locs) {
+    occ.clearEnemies();
+    for (size_t i = 0; i < enemies.size(); ++i) {
+        Point current = enemies[i];
+        Point next = locs[i];
+        if (next.x > current.x) facing[i] = Right;
+        else if (next.x < current.x) facing[i] = Left;
+        else if (next.y > current.y) facing[i] = Down;
+        else if (next.y < current.y) facing[i] = Up;
+        enemies[i] = next;
+        occ.placeEnemy(getArrayIndex(next.x, next.y));
+    }
+}
+
+std::vector<Point> GameState::findPathAStar(Point start, Point goal, Point selfPos) const {
+    SB_PROFILE_SCOPE("findPathAStar");
+    if (start.x < 0 || start.x >= w || start.y < 0 || start.y >= h ||
+        goal.x < 0 || goal.x >= w || goal.y < 0 || goal.y >= h) return {};
+
+    // Walls, boxes and every ghost but the one searching are obstacles
+    int self = getArrayIndex(selfPos.x, selfPos.y);
+    auto isWalkable = [this, self](int cell) {
+        return cell == self || occ.walkable(cell);
+    };
+    auto estimate = [this, goal](int cell) {
+        return std::abs(cell % w - goal.x) + std::abs(cell / w - goal.y);
+    };
+    int to = getArrayIndex(goal.x, goal.y);
+    auto landmarkEstimate = [this, &estimate](int cell) {
+        return std::max(estimate(cell), alt.estimate(cell));
+    };
+
+    // Big maps search over cluster entrances instead, where only walls and
+    // boxes block the way
+    int from = getArrayIndex(start.x, start.y);
+    bool found;
+    if (method == PathMethod::JumpPoint) found = jumps.search(from, to, pathCells);
+    else if (clusters.built()) found = clusters.findPath(from, to, pathCells);
+    else if (useLandmarks && alt.built()) {
+        alt.refresh();
+        alt.aim(from, to);
+        found = pathContext.search(from, to, isWalkable, landmarkEstimate, pathCells);
+    } else found = pathContext.search(from, to, isWalkable, estimate, pathCells);
+    SB_PROFILE_COUNT(NodesExpanded, pathExpansions());
+    SB_PROFILE_COUNT(HeapPushes, pathPushes());
+
+    std::vector<Point> path;
+    if (found) {
+        path.reserve(pathCells.size());
+        for (int cell : pathCells) {
+            path.push_back(Point{cell % w, cell / w});
+        }
+    }
+    return path;
+}
+
+int GameState::heuristic(Point from, Point to) const {
+    int manhattan = std::abs(from.x - to.x) + std::abs(from.y - to.y);
+    if (!useLandmarks || !alt.built()) return manhattan;
+    alt.refresh();
+    return std::max(manhattan, alt.estimate(getArrayIndex(from.x, from.y), getArrayIndex(to.x, to.y)));
+}
+
+void GameState::setLandmarkHeuristic(bool on) {
+    useLandmarks = on;
+}
+
+const Landmarks& GameState::landmarks() const {
+    return alt;
+}
+
+void GameState::setPathMethod(PathMethod newMethod) {
+    method = newMethod;
+    if (method == PathMethod::JumpPoint && !jumps.built() && !gameMatrix.empty()) jumps.build(gameMatrix, w, h);
+}
+
+PathMethod GameState::pathMethod() const {
+    return method;
+}
+
+unsigned GameState::pathExpansions() const {
+    if (method == PathMethod::JumpPoint) return jumps.expanded();
+    return clusters.built() ? clusters.expanded() : pathContext.expanded();
+}
+
+unsigned GameState::pathPushes() const {
+    if (method == PathMethod::JumpPoint) return jumps.pushes();
+    return clusters.built() ? clusters.pushes() : pathContext.pushes();
+}
+
+void GameState::setPlayerLoc(Point loc) {
+    if (loc == player) return;
+    player = loc;
+    field.moveSource(getArrayIndex(loc.x, loc.y));
+}
+
+int GameState::evaluateState() const {
+    int bestScore = -1000; // Initialize with worst-case score
+
+    for (const auto& enemyPos : enemies) {
+        int d = field.distance(getArrayIndex(enemyPos.x, enemyPos.y));
+        if (d != FlowField::kUnreachable) {
+            int score = -(d + 1);
+            if (score > bestScore) {
+                bestScore = score; // Closer enemy = better state
+            }
+        }
+    }
+
+    return bestScore;
+}
+
+bool GameState::isGameOver() const {
+    return player.x >= 0 && occ.enemy(getArrayIndex(player.x, player.y));
+}
+
+// Won once no box is left off a goal, or once every goal is filled on a
+// level with more boxes than goals.
+bool GameState::isWon() const {
+    if (gameMatrix.empty()) return false;
+    return unplaced == 0 || (openGoals == 0 && placed > 0);
+}
+
+int GameState::boxesPlaced() const {
+    return placed;
+}
+
+int GameState::boxTotal() const {
+    return placed + unplaced;
+}
+
+float GameState::progress() const {
+    int target = std::min(placed + unplaced, placed + openGoals);
+    return target > 0 ? static_cast<float>(placed) / target : 1.0f;
+}
+
+void GameState::tally(char c, int delta) {
+    if (c == 'A') unplaced += delta;
+    else if (c == 'a') openGoals += delta;
+    else if (c == '1') placed += delta;
+}
+
+void GameState::setTile(int cell, char c) {
+    tally(gameMatrix[cell], -1);
+    tally(c, 1);
+    gameMatrix[cell] = c;
+}
+
+void GameState::refreshDeadlock() {
+    stuck = false;
+    auto isBox = [this](int cell) { return occ.box(cell); };
+    for (int i = 0; i < h * w && everyBoxNeeded && !stuck; ++i) {
+        if (gameMatrix[i] == 'A' && deadlock.isDeadSquare(i)) stuck = true;
+        else if (occ.box(i) && deadlock.isFrozen(i, isBox)) stuck = true;
+    }
+}
+
+bool GameState::isDeadlocked() const {
+    return stuck;
+}
+
+const DeadlockAnalysis& GameState::deadlocks() const {
+    return deadlock;
+}
+
+Bitboard GameState::reachableFromPlayer() const {
+    return occ.reachable(getArrayIndex(player.x, player.y));
+}
+
+const Occupancy& GameState::occupancy() const {
+    return occ;
+}
+
+const FlowField& GameState::flowField() const {
+    return field;
+}
+
+void GameState::settleField() {
+    field.settle();
+}
+
+int GameState::getArrayIndex(int x, int y) const {
+    return x + y * w;
+}
+
+std::uint64_t GameState::layoutVersion() const {
+    return layout;
+}
+
+// Drawn from a process-wide counter: a reset copy or an undo may bring back
+// an old layout, and it must not match a version some cache saw for another
+void GameState::touchLayout() {
+    layout = nextLayout.fetch_add(1, std::memory_order_relaxed);
+}
+
+void GameState::convertToMatrixSpace(int i, int& x, int& y) const {
+    x = i % w;
+    y = i / w;
+}
+
+void GameState::load(int width, int height, std::vector<char> grid, Point playerAt, std::vector<Point> enemyAt) {
+    h = height;
+    w = width;
+    gameMatrix = std::move(grid);
+    player = playerAt;
+    heading = Down;
+    enemies = std::move(enemyAt);
+    facing.assign(enemies.size(), Down);
+
+    occ.build(gameMatrix, w, h);
+    touchLayout();
+    for (const auto& e : enemies) {
+        occ.placeEnemy(getArrayIndex(e.x, e.y));
+    }
+    pathContext.resize(w, h);
+    if (w * h >= kClusteredArea) {
+        clusters.build(gameMatrix, w, h);
+        alt = Landmarks();
+    } else {
+        clusters = ClusterGraph();
+        alt.build(gameMatrix, w, h, kLandmarks);
+    }
+    if (method == PathMethod::JumpPoint) jumps.build(gameMatrix, w, h);
+    else jumps = JumpPointSearch();
+
+    deadlock.analyze(gameMatrix, w, h);
+    unplaced = openGoals = placed = 0;
+    for (char c : gameMatrix) {
+        tally(c, 1);
+    }
+    everyBoxNeeded = unplaced <= openGoals;
+    refreshDeadlock();
+    field.build(gameMatrix, w, h, getArrayIndex(player.x, player.y));
+}
+
+std::istream& operator>>(std::istream& in, GameState& state) {
+    int height = 0, width = 0;
+    in >> height >> width;
+    std::vector<char> grid(height * width);
+    Point player{-1, -1};
+    std::vector<Point> enemies;
+
+    for (int i = 0; i < height * width; ++i) {
+        in >> grid[i];
+        if (grid[i] == '@') {
+            player = {i % width, i / width};
+        }
+        if (grid[i] == 'G') {
+            enemies.push_back(Point{i % width, i / width});
+        }
+    }
+    state.load(width, height, std::move(grid), player, std::move(enemies));
+    return in;
+}
+
+std::ostream& operator<<(std::ostream& out, const GameState& state) {
+    out << state.h << " " << state.w;
+    return out;
+}
+
+} // namespace SB
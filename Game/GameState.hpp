@@ -0,0 +1,151 @@
+#ifndef GameState_HPP
+#define GameState_HPP
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "Bitboard.hpp"
+#include "ClusterGraph.hpp"
+#include "Deadlock.hpp"
+#include "FlowField.hpp"
+#include "JumpPointSearch.hpp"
+#include "Landmarks.hpp"
+#include "PathContext.hpp"
+
+namespace SB {
+
+enum Direction { Up, Down, Left, Right };
+
+struct Point {
+    int x;
+    int y;
+};
+
+inline bool operator==(Point a, Point b) { return a.x == b.x && a.y == b.y; }
+inline bool operator!=(Point a, Point b) { return !(a == b); }
+
+// Search used by findPathAStar. Jump points, like the cluster graph on big
+// maps, only treat walls and boxes as obstacles.
+enum class PathMethod { AStar, JumpPoint };
+
+// Tile grid plus integer actor coordinates: everything needed to play a
+// level without SFML. Copying a GameState forks the simulation.
+class GameState {
+public:
+    GameState();
+
+    // Unit tile offset for a direction
+    static Point offset(Direction direction);
+
+    int height() const;
+    int width() const;
+    Point playerLoc() const;
+    const std::vector<Point>& enemyLocs() const;
+    Direction playerFacing() const;
+    Direction enemyFacing(size_t enemy) const;
+    const std::vector<char>& tiles() const;
+    char tile(int x, int y) const;
+
+    // Applies one player move with the usual push rules. Returns false if
+    // the player stayed where they were.
+    bool step(Direction direction);
+    // Moves every enemy one tile toward the player.
+    void tickEnemies();
+    // Takes back a step() that moved the player in `direction`, leaving them
+    // facing the way they did before it.
+    void undoStep(Direction direction, bool pushed, Direction facing);
+    // Moves every enemy at once, e.g. to a planned joint move.
+    void setEnemyLocs(const std::vector<Point>& locs);
+    // Puts the player on a free tile without the move or push rules, e.g.
+    // to bring a copy of the level up to date.
+    void setPlayerLoc(Point loc);
+    // Moves the box on cell `from` to the free cell `to`, again without the
+    // push rules
+    void moveBox(int from, int to);
+
+    // Reads the distance field, so wants settleField() first
+    int evaluateState() const;
+    bool isWon() const;
+    // Boxes resting on goals, and boxes in total
+    int boxesPlaced() const;
+    int boxTotal() const;
+    // Fraction of the boxes needed to win that are already on goals
+    float progress() const;
+    bool isGameOver() const;
+    // True once a box is stuck where it can never be stored. Only reported
+    // on levels where every box has to reach a goal.
+    bool isDeadlocked() const;
+    const DeadlockAnalysis& deadlocks() const;
+
+    std::vector<Point> findPathAStar(Point start, Point goal, Point selfPos) const;
+    // Lower bound on the walking distance between two tiles that grid A*
+    // searches with: the landmark bound where landmarks are built, at least
+    // the Manhattan distance.
+    int heuristic(Point from, Point to) const;
+    // Grid A* uses landmarks by default; off falls back to Manhattan alone.
+    void setLandmarkHeuristic(bool on);
+    const Landmarks& landmarks() const;
+    void setPathMethod(PathMethod method);
+    PathMethod pathMethod() const;
+    // Nodes the last findPathAStar expanded
+    unsigned pathExpansions() const;
+    // Open-list pushes in the last findPathAStar
+    unsigned pathPushes() const;
+    Bitboard reachableFromPlayer() const;
+    const Occupancy& occupancy() const;
+    // The player's distance field. Steps leave it to expand lazily; const
+    // reads, such as the planners', need settleField() called first.
+    const FlowField& flowField() const;
+    void settleField();
+    // Changes whenever a wall or box does. Copies share it, and two
+    // different layouts never get the same value, so it can key caches.
+    std::uint64_t layoutVersion() const;
+
+    int getArrayIndex(int x, int y) const;
+    void convertToMatrixSpace(int i, int& x, int& y) const;
+
+    // Replaces the level. `grid` holds one tile character per cell and still
+    // includes the '@' and 'G' markers; the actor positions are passed in so
+    // the grid does not have to be scanned for them.
+    void load(int width, int height, std::vector<char> grid, Point playerAt, std::vector<Point> enemyAt);
+
+    friend std::istream& operator>>(std::istream& in, GameState& state);
+    friend std::ostream& operator<<(std::ostream& out, const GameState& state);
+
+private:
+    void refreshDeadlock();
+    void touchLayout();
+    void shiftBox(int from, int to);
+    void tally(char c, int delta);
+    // Writes a tile and keeps the box/goal counters in step with it
+    void setTile(int cell, char c);
+
+    int h;
+    int w;
+    std::vector<char> gameMatrix;
+    Point player;
+    Direction heading;
+    std::vector<Point> enemies;
+    std::vector<Direction> facing;
+    int unplaced;   // 'A': boxes off a goal
+    int openGoals;  // 'a': empty goals
+    int placed;     // '1': boxes on a goal
+    Occupancy occ;
+    FlowField field;
+    DeadlockAnalysis deadlock;
+    bool everyBoxNeeded;
+    bool stuck;
+    std::uint64_t layout;
+    mutable PathContext pathContext;
+    mutable ClusterGraph clusters;
+    PathMethod method;
+    mutable JumpPointSearch jumps;
+    mutable Landmarks alt;
+    bool useLandmarks;
+    mutable std::vector<int> pathCells;
+};
+
+} // namespace SB
+
+#endif // GameState_HPP
@@ -0,0 +1,226 @@
+#include "JumpPointSearch.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include "FlowField.hpp"
+#include "GameState.hpp"
+
+namespace SB {
+
+JumpPointSearch::JumpPointSearch() : w(0), h(0), anyDirty(false), generation(0), expansions(0) {}
+
+void JumpPointSearch::build(const std::vector<char>& grid, int width, int height) {
+    w = width;
+    h = height;
+    walkable.assign(w * h, 0);
+    for (int i = 0; i < w * h; ++i) {
+        walkable[i] = !FlowField::isObstacle(grid[i]);
+    }
+    for (int d = 0; d < 4; ++d) {
+        jump[d].assign(w * h, 0);
+        run[d].assign(w * h, 0);
+    }
+    columnDirty.assign(w, 1);
+    rowDirty.assign(h, 1);
+    anyDirty = true;
+    refresh();
+
+    stamp.assign(w * h, 0);
+    generation = 0;
+    g.assign(w * h, 0);
+    parent.assign(w * h, -1);
+    closed.assign(w * h, 0);
+    heap.reset(w * h);
+}
+
+bool JumpPointSearch::built() const {
+    return !walkable.empty();
+}
+
+bool JumpPointSearch::open(int x, int y) const {
+    return x >= 0 && x < w && y >= 0 && y < h && walkable[x + y * w];
+}
+
+// Reached (x, y) moving by dy: a side that was walled one row back is
+// open here, so a canonical path may turn now.
+bool JumpPointSearch::verticalJumpPoint(int x, int y, int dy) const {
+    return (open(x - 1, y) && !open(x - 1, y - dy)) || (open(x + 1, y) && !open(x + 1, y - dy));
+}
+
+void JumpPointSearch::computeColumn(int x) {
+    for (int pass = 0; pass < 2; ++pass) {
+        Direction d = pass == 0 ? Up : Down;
+        int dy = pass == 0 ? -1 : 1;
+        for (int k = 0; k < h; ++k) {
+            int y = pass == 0 ? k : h - 1 - k;
+            int cell = x + y * w;
+            int before = jump[d][cell];
+            int ny = y + dy;
+            if (!open(x, ny)) {
+                run[d][cell] = 0;
+                jump[d][cell] = 0;
+            } else {
+                int next = x + ny * w;
+                run[d][cell] = 1 + run[d][next];
+                if (verticalJumpPoint(x, ny, dy)) jump[d][cell] = 1;
+                else jump[d][cell] = jump[d][next] > 0 ? jump[d][next] + 1 : 0;
+            }
+            if (jump[d][cell] != before) rowDirty[y] = 1;
+        }
+    }
+}
+
+// A horizontal run stops wherever a vertical jump would find something
+void JumpPointSearch::computeRow(int y) {
+    for (int pass = 0; pass < 2; ++pass) {
+        Direction d = pass == 0 ? Left : Right;
+        int dx = pass == 0 ? -1 : 1;
+        for (int k = 0; k < w; ++k) {
+            int x = pass == 0 ? k : w - 1 - k;
+            int cell = x + y * w;
+            int nx = x + dx;
+            if (!open(nx, y)) {
+                run[d][cell] = 0;
+                jump[d][cell] = 0;
+                continue;
+            }
+            int next = nx + y * w;
+            run[d][cell] = 1 + run[d][next];
+            if (jump[Up][next] > 0 || jump[Down][next] > 0) jump[d][cell] = 1;
+            else jump[d][cell] = jump[d][next] > 0 ? jump[d][next] + 1 : 0;
+        }
+    }
+}
+
+void JumpPointSearch::setBlocked(int cell, bool isBlocked) {
+    if (!built() || walkable[cell] == !isBlocked) return;
+    walkable[cell] = !isBlocked;
+    int x = cell % w;
+    for (int c = x - 1; c <= x + 1; ++c) {
+        if (c >= 0 && c < w) columnDirty[c] = 1;
+    }
+    rowDirty[cell / w] = 1;
+    anyDirty = true;
+}
+
+void JumpPointSearch::refresh() {
+    if (!anyDirty) return;
+    for (int x = 0; x < w; ++x) {
+        if (columnDirty[x]) computeColumn(x);
+        columnDirty[x] = 0;
+    }
+    for (int y = 0; y < h; ++y) {
+        if (rowDirty[y]) computeRow(y);
+        rowDirty[y] = 0;
+    }
+    anyDirty = false;
+}
+
+bool JumpPointSearch::search(int start, int goal, std::vector<int>& path) {
+    path.clear();
+    expansions = 0;
+    if (!built() || start < 0 || goal < 0 || start >= w * h || goal >= w * h) return false;
+    if (!walkable[goal]) return false;
+    refresh();
+
+    if (++generation == 0) {
+        std::fill(stamp.begin(), stamp.end(), 0);
+        generation = 1;
+    }
+    heap.clear();
+    int gx = goal % w;
+    int gy = goal / w;
+    auto estimate = [this, gx, gy](int cell) {
+        return std::abs(cell % w - gx) + std::abs(cell / w - gy);
+    };
+
+    int current = start;
+    auto relax = [&](int next, int cost) {
+        int tentative = g[current] + cost;
+        if (stamp[next] != generation) {
+            stamp[next] = generation;
+            closed[next] = 0;
+            g[next] = tentative;
+            parent[next] = current;
+            heap.push(next, tentative + estimate(next));
+        } else if (!closed[next] && tentative < g[next]) {
+            g[next] = tentative;
+            parent[next] = current;
+            heap.decrease(next, tentative + estimate(next));
+        }
+    };
+
+    stamp[start] = generation;
+    closed[start] = 0;
+    g[start] = 0;
+    parent[start] = -1;
+    heap.push(start, estimate(start));
+    while (!heap.empty()) {
+        current = heap.pop();
+        if (current == goal) {
+            // Jump points are joined by straight runs; fill in the tiles
+            for (int c = goal; c != start; c = parent[c]) {
+                int p = parent[c];
+                int step = (c % w != p % w) ? (c > p ? 1 : -1) : (c > p ? w : -w);
+                for (int t = c; t != p; t -= step) path.push_back(t);
+            }
+            path.push_back(start);
+            std::reverse(path.begin(), path.end());
+            return true;
+        }
+        closed[current] = 1;
+        ++expansions;
+
+        int cx = current % w;
+        int cy = current / w;
+        int p = parent[current];
+        bool dirs[4] = {true, true, true, true};
+        if (p >= 0) {
+            if (p / w == cy) {
+                Direction arrived = cx > p % w ? Right : Left;
+                dirs[arrived == Right ? Left : Right] = false;
+            } else {
+                int dy = cy > p / w ? 1 : -1;
+                dirs[dy > 0 ? Up : Down] = false;
+                dirs[Left] = open(cx - 1, cy) && !open(cx - 1, cy - dy);
+                dirs[Right] = open(cx + 1, cy) && !open(cx + 1, cy - dy);
+            }
+        }
+
+        for (int d = 0; d < 4; ++d) {
+            if (!dirs[d]) continue;
+            int j = jump[d][current];
+            int r = run[d][current];
+            if (d == Up || d == Down) {
+                int dy = d == Up ? -1 : 1;
+                int toGoal = (gy - cy) * dy;
+                if (gx == cx && toGoal > 0 && toGoal <= r && (j == 0 || toGoal <= j)) relax(goal, toGoal);
+                else if (j > 0) relax(current + j * dy * w, j);
+            } else {
+                int dx = d == Left ? -1 : 1;
+                int toColumn = (gx - cx) * dx;
+                if (toColumn > 0 && toColumn <= r && (j == 0 || toColumn <= j)) {
+                    // The goal's column: stop here if a vertical run reaches it
+                    int turn = gx + cy * w;
+                    int dy = gy - cy;
+                    if (dy == 0 || run[dy < 0 ? Up : Down][turn] >= std::abs(dy)) {
+                        relax(turn, toColumn);
+                        continue;
+                    }
+                }
+                if (j > 0) relax(current + j * dx, j);
+            }
+        }
+    }
+    return false;
+}
+
+unsigned JumpPointSearch::expanded() const {
+    return expansions;
+}
+
+unsigned JumpPointSearch::pushes() const {
+    return heap.pushes();
+}
+
+} // namespace SB
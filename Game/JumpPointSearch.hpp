@@ -0,0 +1,62 @@
+#ifndef JumpPointSearch_HPP
+#define JumpPointSearch_HPP
+
+#include <vector>
+#include "PathContext.hpp"
+
+namespace SB {
+
+// Jump point search for the 4-connected grid, JPS+ style. Paths are taken
+// in canonical form: horizontal runs first, turning vertical only where the
+// horizontal run could not have got there. A vertical jump stops where a
+// side opens up that was walled one step back; a horizontal jump stops
+// where a vertical jump from it would stop. Both distances are precomputed
+// per cell and direction, so a jump is a table lookup.
+//
+// Walls and boxes are obstacles. When a tile changes, the three columns
+// around it are recomputed, plus any row whose vertical jumps changed, on
+// the next search.
+class JumpPointSearch {
+public:
+    JumpPointSearch();
+
+    void build(const std::vector<char>& grid, int width, int height);
+    bool built() const;
+    void setBlocked(int cell, bool isBlocked);
+
+    // On success `path` holds every tile from start to goal.
+    bool search(int start, int goal, std::vector<int>& path);
+    unsigned expanded() const;
+    unsigned pushes() const;
+
+private:
+    bool open(int x, int y) const;
+    void computeColumn(int x);
+    void computeRow(int y);
+    void refresh();
+    bool verticalJumpPoint(int x, int y, int dy) const;
+
+    int w;
+    int h;
+    std::vector<char> walkable;
+    // Indexed by Direction, then cell. `jump` is the distance to the next
+    // jump point in that direction (0 if none before a wall); `run` is the
+    // number of open tiles before the wall.
+    std::vector<int> jump[4];
+    std::vector<int> run[4];
+    std::vector<char> columnDirty;
+    std::vector<char> rowDirty;
+    bool anyDirty;
+
+    unsigned generation;
+    unsigned expansions;
+    std::vector<unsigned> stamp;
+    std::vector<int> g;
+    std::vector<int> parent;
+    std::vector<char> closed;
+    IndexedHeap heap;
+};
+
+} // namespace SB
+
+#endif // JumpPointSearch_HPP
@@ -0,0 +1,150 @@
+#include "Landmarks.hpp"
+
+#include <chrono>
+#include "FlowField.hpp"
+
+namespace SB {
+
+Landmarks::Landmarks() : w(0), h(0), k(0), dirty(false), actives(0), builds(0), buildSeconds(0) {}
+
+void Landmarks::build(const std::vector<char>& grid, int width, int height, int count) {
+    auto started = std::chrono::steady_clock::now();
+    w = width;
+    h = height;
+    walls.resize(w * h);
+    for (int i = 0; i < w * h; ++i) {
+        walls[i] = FlowField::isObstacle(grid[i]);
+    }
+    queue.reserve(w * h);
+
+    // Farthest-first: each landmark is the open tile farthest from every
+    // landmark so far. Tiles none of them reach count as farthest of all,
+    // so every walled-off region gets a landmark of its own.
+    sources.clear();
+    std::vector<std::uint16_t> nearest(w * h, kUnreached);
+    int seed = -1;
+    for (int i = 0; i < w * h && seed < 0; ++i) {
+        if (!walls[i]) seed = i;
+    }
+    if (seed >= 0) {
+        distancesFrom(seed, scratch);
+        int far = seed;
+        for (int i = 0; i < w * h; ++i) {
+            if (scratch[i] != kUnreached && scratch[i] > scratch[far]) far = i;
+        }
+        while (static_cast<int>(sources.size()) < count) {
+            sources.push_back(far);
+            distancesFrom(far, scratch);
+            int best = -1;
+            for (int i = 0; i < w * h; ++i) {
+                if (scratch[i] < nearest[i]) nearest[i] = scratch[i];
+                if (walls[i] || nearest[i] == 0) continue;
+                if (best < 0 || nearest[i] > nearest[best]) best = i;
+            }
+            if (best < 0) break;
+            far = best;
+        }
+    }
+    k = static_cast<int>(sources.size());
+
+    builds = 0;
+    fillTables();
+    buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+bool Landmarks::built() const {
+    return !walls.empty();
+}
+
+void Landmarks::setBlocked(int cell, bool isBlocked) {
+    if (walls.empty() || walls[cell] == isBlocked) return;
+    walls[cell] = isBlocked;
+    if (!isBlocked) dirty = true;
+}
+
+void Landmarks::refresh() {
+    if (!dirty) return;
+    auto started = std::chrono::steady_clock::now();
+    fillTables();
+    buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+void Landmarks::aim(int start, int goal) {
+    actives = 0;
+    if (k == 0) return;
+    const std::uint16_t* a = &table[static_cast<size_t>(start) * k];
+    const std::uint16_t* b = &table[static_cast<size_t>(goal) * k];
+    int gaps[kActive];
+    for (int l = 0; l < k; ++l) {
+        if (a[l] == kUnreached || b[l] == kUnreached) continue;
+        int gap = a[l] > b[l] ? a[l] - b[l] : b[l] - a[l];
+        // Insertion into the kActive largest gaps so far
+        int i = actives < kActive ? actives++ : kActive;
+        while (i > 0 && gaps[i - 1] < gap) {
+            if (i < kActive) {
+                gaps[i] = gaps[i - 1];
+                active[i] = active[i - 1];
+            }
+            --i;
+        }
+        if (i < kActive) {
+            gaps[i] = gap;
+            active[i] = l;
+        }
+    }
+    for (int i = 0; i < actives; ++i) goalDistance[i] = b[active[i]];
+}
+
+int Landmarks::estimate(int cell, int goal) {
+    aim(cell, goal);
+    return estimate(cell);
+}
+
+void Landmarks::fillTables() {
+    table.assign(static_cast<size_t>(w) * h * k, kUnreached);
+    for (int l = 0; l < k; ++l) {
+        distancesFrom(sources[l], scratch);
+        for (int i = 0; i < w * h; ++i) {
+            table[static_cast<size_t>(i) * k + l] = scratch[i];
+        }
+    }
+    dirty = false;
+    ++builds;
+}
+
+// A landmark covered by a box still spreads distances to its neighbours
+void Landmarks::distancesFrom(int source, std::vector<std::uint16_t>& out) {
+    out.assign(w * h, kUnreached);
+    out[source] = 0;
+    queue.clear();
+    queue.push_back(source);
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int current = queue[head];
+        int x = current % w;
+        int adj[4] = {x + 1 < w ? current + 1 : -1, x > 0 ? current - 1 : -1,
+                      current + w < w * h ? current + w : -1, current - w};
+        for (int n : adj) {
+            if (n < 0 || walls[n] || out[n] != kUnreached) continue;
+            out[n] = out[current] + 1;
+            queue.push_back(n);
+        }
+    }
+}
+
+int Landmarks::count() const {
+    return k;
+}
+
+size_t Landmarks::memoryBytes() const {
+    return table.size() * sizeof(std::uint16_t) + walls.size() + sources.size() * sizeof(int);
+}
+
+unsigned Landmarks::rebuilds() const {
+    return builds;
+}
+
+double Landmarks::lastBuildSeconds() const {
+    return buildSeconds;
+}
+
+} // namespace SB
@@ -0,0 +1,82 @@
+#ifndef Landmarks_HPP
+#define Landmarks_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SB {
+
+// ALT distance oracle: BFS distances from a handful of landmark tiles, used
+// as a lower bound on the distance between any two tiles through the
+// triangle inequality, |d(L, goal) - d(L, cell)| <= d(cell, goal). Landmarks
+// are picked farthest-first so that they sit at the ends of corridors and
+// dead ends, where Manhattan distance is furthest off.
+//
+// A query only consults the few landmarks that give the tightest bound
+// between its start and goal, with the goal's distances copied out.
+//
+// Walls and boxes are obstacles. A tile closing up only makes distances
+// longer, so the old tables stay a valid lower bound; a tile opening up
+// marks them stale, and refresh() redoes the BFS from every landmark.
+class Landmarks {
+public:
+    static constexpr std::uint16_t kUnreached = 0xFFFF;
+    static const int kActive = 3;
+
+    Landmarks();
+
+    void build(const std::vector<char>& grid, int width, int height, int count = 8);
+    bool built() const;
+    void setBlocked(int cell, bool isBlocked);
+    // Brings stale tables up to date; estimate() assumes it has been called.
+    void refresh();
+
+    // Picks the landmarks for a search from `start` to `goal`, which the
+    // estimate(cell) calls that follow measure against.
+    void aim(int start, int goal);
+    int estimate(int cell) const;
+    int estimate(int cell, int goal);
+
+    int count() const;
+    size_t memoryBytes() const;
+    // Table builds so far, and how long the last one took
+    unsigned rebuilds() const;
+    double lastBuildSeconds() const;
+
+private:
+    void distancesFrom(int source, std::vector<std::uint16_t>& out);
+    void fillTables();
+
+    int w;
+    int h;
+    int k;
+    bool dirty;
+    std::vector<char> walls;
+    std::vector<int> sources;
+    // k distances per cell, so one lookup touches one cache line
+    std::vector<std::uint16_t> table;
+    std::vector<std::uint16_t> scratch;
+    std::vector<int> queue;
+    int active[kActive];
+    int goalDistance[kActive];
+    int actives;
+    unsigned builds;
+    double buildSeconds;
+};
+
+inline int Landmarks::estimate(int cell) const {
+    const std::uint16_t* d = &table[static_cast<size_t>(cell) * k];
+    int best = 0;
+    for (int i = 0; i < actives; ++i) {
+        int here = d[active[i]];
+        if (here == kUnreached) continue;
+        int gap = here > goalDistance[i] ? here - goalDistance[i] : goalDistance[i] - here;
+        if (gap > best) best = gap;
+    }
+    return best;
+}
+
+} // namespace SB
+
+#endif // Landmarks_HPP
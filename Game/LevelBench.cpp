@@ -0,0 +1,154 @@
+#include "LevelBench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include "EnemyPlanner.hpp"
+#include "Solver.hpp"
+#include "WorkPool.hpp"
+
+namespace SB {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Outcome { Won, Lost, TimedOut };
+
+struct Episode {
+    Outcome outcome = Outcome::TimedOut;
+    std::uint64_t steps = 0;
+    std::vector<std::uint32_t> tickNanos;
+};
+
+Episode play(GameState game, const std::vector<Direction>& script,
+             const BenchOptions& options, std::uint32_t seed) {
+    Episode episode;
+    episode.tickNanos.reserve(options.maxSteps / std::max(1, options.movesPerTick) + 1);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    size_t next = 0;
+
+    for (int step = 0; step < options.maxSteps; ++step) {
+        ++episode.steps;
+        if (options.policy == PlayerPolicy::Random || next >= script.size()) {
+            game.step(static_cast<Direction>(rng() % 4));
+        } else if (chance(rng) >= options.hesitation) {
+            Point before = game.playerLoc();
+            game.step(script[next]);
+            // A ghost on the route holds the player until it moves on
+            if (game.playerLoc() != before) ++next;
+        }
+        if (game.isWon()) {
+            episode.outcome = Outcome::Won;
+            return episode;
+        }
+
+        if ((step + 1) % std::max(1, options.movesPerTick) == 0) {
+            Clock::time_point start = Clock::now();
+            if (options.planBudget > 0) {
+                // One planner per worker so its caches carry over between episodes
+                static thread_local EnemyPlanner planner;
+                game.settleField();
+                game.setEnemyLocs(planner.plan(game, options.planBudget));
+            } else {
+                game.tickEnemies();
+            }
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+            episode.tickNanos.push_back(static_cast<std::uint32_t>(elapsed.count()));
+        }
+        if (game.isGameOver()) {
+            episode.outcome = Outcome::Lost;
+            return episode;
+        }
+    }
+    return episode;
+}
+
+double percentile(std::vector<std::uint32_t>& samples, double p) {
+    if (samples.empty()) return 0;
+    size_t k = std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k] / 1000.0;
+}
+
+void summarize(LevelReport& report, std::vector<std::uint32_t>& samples) {
+    report.ticks = samples.size();
+    report.tickP50 = percentile(samples, 0.50);
+    report.tickP90 = percentile(samples, 0.90);
+    report.tickP99 = percentile(samples, 0.99);
+    report.tickMax = samples.empty() ? 0 : *std::max_element(samples.begin(), samples.end()) / 1000.0;
+}
+
+} // namespace
+
+double BenchReport::stepsPerSecond() const {
+    return seconds > 0 ? total.steps / seconds : 0;
+}
+
+void LevelBench::addLevel(const std::string& name, const GameState& state) {
+    levels.push_back(Level{name, state, {}});
+}
+
+BenchReport LevelBench::run(const BenchOptions& options) {
+    WorkPool pool(options.threads);
+    BenchReport report;
+    report.threads = pool.size();
+    report.planBudget = options.planBudget;
+
+    if (options.policy == PlayerPolicy::Scripted) {
+        for (auto& level : levels) {
+            if (!level.script.empty()) continue;
+            pool.submit([&level] {
+                Solver solver;
+                level.script = solver.solve(level.state).moves;
+            });
+        }
+        pool.wait();
+    }
+
+    // One task per episode; results land in their own slots so the workers
+    // never share anything they write.
+    std::vector<std::vector<Episode>> results(levels.size());
+    Clock::time_point start = Clock::now();
+    for (size_t l = 0; l < levels.size(); ++l) {
+        results[l].resize(options.episodes);
+        for (int e = 0; e < options.episodes; ++e) {
+            std::uint32_t seed = options.seed * 2654435761u + static_cast<std::uint32_t>(l * 100003 + e);
+            pool.submit([this, &results, &options, l, e, seed] {
+                results[l][e] = play(levels[l].state, levels[l].script, options, seed);
+            });
+        }
+    }
+    pool.wait();
+    report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<std::uint32_t> all;
+    report.total.name = "total";
+    for (size_t l = 0; l < levels.size(); ++l) {
+        LevelReport level;
+        level.name = levels[l].name;
+        std::vector<std::uint32_t> samples;
+        for (const Episode& episode : results[l]) {
+            ++level.episodes;
+            level.wins += episode.outcome == Outcome::Won;
+            level.losses += episode.outcome == Outcome::Lost;
+            level.timeouts += episode.outcome == Outcome::TimedOut;
+            level.steps += episode.steps;
+            samples.insert(samples.end(), episode.tickNanos.begin(), episode.tickNanos.end());
+        }
+        all.insert(all.end(), samples.begin(), samples.end());
+        summarize(level, samples);
+
+        report.total.episodes += level.episodes;
+        report.total.wins += level.wins;
+        report.total.losses += level.losses;
+        report.total.timeouts += level.timeouts;
+        report.total.steps += level.steps;
+        report.levels.push_back(level);
+    }
+    summarize(report.total, all);
+    return report;
+}
+
+} // namespace SB
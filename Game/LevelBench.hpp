@@ -0,0 +1,70 @@
+#ifndef LevelBench_HPP
+#define LevelBench_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GameState.hpp"
+
+namespace SB {
+
+enum class PlayerPolicy { Random, Scripted };
+
+struct BenchOptions {
+    int episodes = 32;        // per level
+    int maxSteps = 2000;      // player actions before an episode times out
+    int movesPerTick = 2;     // player actions between enemy ticks
+    PlayerPolicy policy = PlayerPolicy::Scripted;
+    double hesitation = 0.2;  // chance a scripted player waits a turn
+    double planBudget = 0;    // seconds per tick for EnemyPlanner; 0 keeps the greedy chase
+    unsigned threads = 0;
+    unsigned seed = 1;
+};
+
+// Enemy tick latencies are in microseconds.
+struct LevelReport {
+    std::string name;
+    int episodes = 0;
+    int wins = 0;
+    int losses = 0;
+    int timeouts = 0;
+    std::uint64_t steps = 0;
+    std::uint64_t ticks = 0;
+    double tickP50 = 0;
+    double tickP90 = 0;
+    double tickP99 = 0;
+    double tickMax = 0;
+};
+
+struct BenchReport {
+    std::vector<LevelReport> levels;
+    LevelReport total;
+    double planBudget = 0;    // the run's BenchOptions::planBudget
+    unsigned threads = 0;
+    double seconds = 0;
+
+    double stepsPerSecond() const;
+};
+
+// Plays many headless episodes of every level, enemy AI against a random
+// or scripted player, spread over a work-stealing pool. The scripted player
+// follows the solver's line, waiting a random turn now and then so that
+// episodes differ, and retries a move while a ghost blocks it.
+class LevelBench {
+public:
+    void addLevel(const std::string& name, const GameState& state);
+    BenchReport run(const BenchOptions& options);
+
+private:
+    struct Level {
+        std::string name;
+        GameState state;
+        std::vector<Direction> script;
+    };
+
+    std::vector<Level> levels;
+};
+
+} // namespace SB
+
+#endif // LevelBench_HPP
@@ -0,0 +1,165 @@
+#include "LevelFile.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace SB {
+
+namespace {
+
+const char kTileChars[] = {'.', '#', 'A', 'a', '1', '@', 'G'};
+const int kTileKinds = sizeof(kTileChars);
+
+int tileCode(char c) {
+    for (int i = 0; i < kTileKinds; ++i) {
+        if (kTileChars[i] == c) return i;
+    }
+    return -1;
+}
+
+// Fields are stored little-endian whatever the host's byte order
+std::uint32_t readU32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+void writeU32(std::vector<unsigned char>& out, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+// Read-only view of a whole file, unmapped when it goes out of scope
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) : data(nullptr), length(0) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* p = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data = static_cast<const unsigned char*>(p);
+                length = info.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data) munmap(const_cast<unsigned char*>(data), length);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data;
+    size_t length;
+};
+
+}
+
+const char* const LevelFile::kExtension = ".sblv";
+
+bool LevelFile::isCompiled(const std::string& path) {
+    size_t n = std::strlen(kExtension);
+    return path.size() >= n && path.compare(path.size() - n, n, kExtension) == 0;
+}
+
+bool LevelFile::read(const std::string& path, GameState& state) {
+    if (isCompiled(path)) return load(path, state);
+    std::ifstream in(path);
+    if (!in.is_open()) return false;
+    in >> state;
+    return true;
+}
+
+bool LevelFile::load(const std::string& path, GameState& state) {
+    MappedFile file(path);
+    Header header;
+    if (!file.data || file.length < kHeaderBytes) return false;
+    std::memcpy(header.magic, file.data, 4);
+    header.version = readU32(file.data + 4);
+    header.width = readU32(file.data + 8);
+    header.height = readU32(file.data + 12);
+    header.enemies = readU32(file.data + 16);
+    if (std::memcmp(header.magic, "SBLV", 4) != 0 || header.version != kVersion) return false;
+
+    // A damaged header must not size the grid or index outside it
+    size_t cells = static_cast<size_t>(header.width) * header.height;
+    if (header.width == 0 || header.height == 0 || cells > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        return false;
+    }
+    size_t actorBytes = (1 + static_cast<size_t>(header.enemies)) * sizeof(std::uint32_t);
+    if (file.length < kHeaderBytes + actorBytes + (cells + 1) / 2) return false;
+
+    std::vector<std::uint32_t> actors(1 + static_cast<size_t>(header.enemies));
+    for (size_t i = 0; i < actors.size(); ++i) {
+        actors[i] = readU32(file.data + kHeaderBytes + i * sizeof(std::uint32_t));
+        // Only the player may be absent
+        bool absent = actors[i] == UINT32_MAX && i == 0;
+        if (!absent && actors[i] >= cells) return false;
+    }
+    auto toPoint = [&header](std::uint32_t cell) {
+        if (cell == UINT32_MAX) return Point{-1, -1};
+        return Point{static_cast<int>(cell % header.width), static_cast<int>(cell / header.width)};
+    };
+    std::vector<Point> enemies;
+    enemies.reserve(header.enemies);
+    for (size_t i = 1; i < actors.size(); ++i) {
+        enemies.push_back(toPoint(actors[i]));
+    }
+
+    // Each packed byte becomes two tile characters with one table lookup
+    static const std::vector<std::uint16_t> pairs = [] {
+        std::vector<std::uint16_t> table(256);
+        for (int b = 0; b < 256; ++b) {
+            char lo = (b & 15) < kTileKinds ? kTileChars[b & 15] : '#';
+            char hi = (b >> 4) < kTileKinds ? kTileChars[b >> 4] : '#';
+            unsigned char out[2] = {static_cast<unsigned char>(lo), static_cast<unsigned char>(hi)};
+            std::memcpy(&table[b], out, 2);
+        }
+        return table;
+    }();
+    std::vector<char> grid(cells + 1);
+    const unsigned char* tiles = file.data + kHeaderBytes + actorBytes;
+    for (size_t i = 0; i < (cells + 1) / 2; ++i) {
+        std::memcpy(&grid[2 * i], &pairs[tiles[i]], 2);
+    }
+    grid.resize(cells);
+
+    state.load(header.width, header.height, std::move(grid), toPoint(actors[0]), std::move(enemies));
+    return true;
+}
+
+bool LevelFile::save(const GameState& state, const std::string& path) {
+    const std::vector<char>& grid = state.tiles();
+    std::vector<unsigned char> packed((grid.size() + 1) / 2, 0);
+    for (size_t i = 0; i < grid.size(); ++i) {
+        int code = tileCode(grid[i]);
+        if (code < 0) return false;
+        packed[i / 2] |= code << (4 * (i % 2));
+    }
+
+    std::vector<unsigned char> bytes = {'S', 'B', 'L', 'V'};
+    writeU32(bytes, kVersion);
+    writeU32(bytes, state.width());
+    writeU32(bytes, state.height());
+    writeU32(bytes, static_cast<std::uint32_t>(state.enemyLocs().size()));
+    Point player = state.playerLoc();
+    writeU32(bytes, player.x < 0 ? UINT32_MAX : static_cast<std::uint32_t>(state.getArrayIndex(player.x, player.y)));
+    for (const Point& e : state.enemyLocs()) {
+        writeU32(bytes, static_cast<std::uint32_t>(state.getArrayIndex(e.x, e.y)));
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) return false;
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    out.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+    return static_cast<bool>(out);
+}
+
+} // namespace SB
@@ -0,0 +1,46 @@
+#ifndef LevelFile_HPP
+#define LevelFile_HPP
+
+#include <cstdint>
+#include <string>
+#include "GameState.hpp"
+
+namespace SB {
+
+// Compiled levels (.sblv) hold the same grid as a .lvl file without any text
+// to parse:
+//
+//   Header     magic "SBLV", version, width, height, enemy count
+//   Actors     player cell, then one cell per enemy (uint32, -1 if absent)
+//   Tiles      one 4-bit tile code per cell, two cells per byte, row-major
+//
+// All fields are little-endian on every host. Loading maps the file, checks
+// that the sizes and actor cells fit the grid, and expands the tile plane
+// through a byte-to-two-tiles table.
+class LevelFile {
+public:
+    static const char* const kExtension;
+
+    // Reads either format, chosen by the file extension.
+    static bool read(const std::string& path, GameState& state);
+    // Maps a compiled level.
+    static bool load(const std::string& path, GameState& state);
+    static bool save(const GameState& state, const std::string& path);
+    static bool isCompiled(const std::string& path);
+
+private:
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t enemies;
+    };
+
+    static const std::uint32_t kVersion = 1;
+    static const size_t kHeaderBytes = 20;
+};
+
+} // namespace SB
+
+#endif // LevelFile_HPP
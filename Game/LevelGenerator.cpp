@@ -0,0 +1,303 @@
+#include "LevelGenerator.hpp"
+
+#include <algorithm>
+#include <random>
+#include <unordered_set>
+#include "Solver.hpp"
+#include "WorkPool.hpp"
+
+namespace SB {
+
+namespace {
+
+// Working data for one candidate room
+class Candidate {
+public:
+    Candidate(int width, int height, std::mt19937& rng) : w(width), h(height), rng(rng) {
+        offsets[Up] = -w;
+        offsets[Down] = w;
+        offsets[Left] = -1;
+        offsets[Right] = 1;
+        floor.assign(w * h, 0);
+        mark.assign(w * h, 0);
+        stamp = 0;
+    }
+
+    // Drunkard's walk from the middle until about half of the inside is open
+    void carve() {
+        int inside = (w - 2) * (h - 2);
+        int open = 0;
+        int x = w / 2, y = h / 2;
+        while (open * 2 < inside) {
+            int cell = x + y * w;
+            if (!floor[cell]) {
+                floor[cell] = 1;
+                ++open;
+            }
+            Point d = GameState::offset(static_cast<Direction>(rng() % 4));
+            x = std::min(std::max(x + d.x, 1), w - 2);
+            y = std::min(std::max(y + d.y, 1), h - 2);
+        }
+    }
+
+    std::vector<int> floorCells() const {
+        std::vector<int> cells;
+        for (int i = 0; i < w * h; ++i) {
+            if (floor[i]) cells.push_back(i);
+        }
+        return cells;
+    }
+
+    // Cells the player reaches from `from` around `boxes`; returns the
+    // lowest one, which stands for the whole region. Reached cells carry
+    // the current stamp.
+    int reach(int from, const std::vector<char>& boxAt) {
+        ++stamp;
+        queue.clear();
+        queue.push_back(from);
+        mark[from] = stamp;
+        int lowest = from;
+        for (size_t head = 0; head < queue.size(); ++head) {
+            int cell = queue[head];
+            lowest = std::min(lowest, cell);
+            for (int dir = 0; dir < 4; ++dir) {
+                int next = cell + offsets[dir];
+                if (!floor[next] || boxAt[next] || mark[next] == stamp) continue;
+                mark[next] = stamp;
+                queue.push_back(next);
+            }
+        }
+        return lowest;
+    }
+
+    bool reached(int cell) const {
+        return mark[cell] == stamp;
+    }
+
+    int w;
+    int h;
+    int offsets[4];
+    std::vector<char> floor;
+    std::vector<unsigned> mark;
+    unsigned stamp;
+    std::vector<int> queue;
+    std::mt19937& rng;
+};
+
+struct Found {
+    std::vector<int> boxes;
+    int player = -1;
+    int depth = 0;
+    std::uint64_t states = 0;
+};
+
+// Breadth-first over pulls, starting with every box on a goal and the
+// player in each region that leaves open. A state is the sorted box cells
+// plus the player's region; the deepest one reached is the hardest start.
+Found pullFromGoals(Candidate& room, const std::vector<int>& goals, int budget) {
+    int cells = room.w * room.h;
+    size_t k = goals.size();
+    std::vector<std::uint64_t> keys(2 * cells);
+    std::mt19937_64 keyRng(0x9e3779b97f4a7c15ull ^ cells);
+    for (auto& key : keys) key = keyRng();
+    auto keyOf = [&keys, cells](const int* boxes, size_t n, int player) {
+        std::uint64_t key = keys[cells + player];
+        for (size_t i = 0; i < n; ++i) key ^= keys[boxes[i]];
+        return key;
+    };
+
+    // Flat queue: k box cells then the normalised player per state
+    std::vector<int> states;
+    std::vector<int> depths;
+    std::unordered_set<std::uint64_t> seen;
+    std::vector<char> boxAt(cells, 0);
+    for (int g : goals) boxAt[g] = 1;
+
+    std::vector<int> start(goals);
+    std::sort(start.begin(), start.end());
+    std::vector<char> covered(cells, 0);
+    for (int cell = 0; cell < cells; ++cell) {
+        if (!room.floor[cell] || boxAt[cell] || covered[cell]) continue;
+        int player = room.reach(cell, boxAt);
+        for (int c : room.queue) covered[c] = 1;
+        seen.insert(keyOf(start.data(), k, player));
+        states.insert(states.end(), start.begin(), start.end());
+        states.push_back(player);
+        depths.push_back(0);
+    }
+    for (int g : goals) boxAt[g] = 0;
+
+    Found best;
+    std::vector<int> next(k);
+    std::vector<std::pair<size_t, int>> pulls;
+    for (size_t s = 0; s < depths.size() && depths.size() < static_cast<size_t>(budget); ++s) {
+        std::vector<int> boxes(states.begin() + s * (k + 1), states.begin() + (s + 1) * (k + 1));
+        int player = boxes[k];
+        int depth = depths[s];
+        if (depth > best.depth) {
+            best.depth = depth;
+            best.boxes.assign(boxes.begin(), boxes.begin() + k);
+            best.player = player;
+        }
+
+        // The player stands at box+d and steps to box+2d, dragging the box
+        for (size_t i = 0; i < k; ++i) boxAt[boxes[i]] = 1;
+        room.reach(player, boxAt);
+        pulls.clear();
+        for (size_t i = 0; i < k; ++i) {
+            for (int dir = 0; dir < 4; ++dir) {
+                int from = boxes[i] + room.offsets[dir];
+                int to = from + room.offsets[dir];
+                if (room.reached(from) && room.floor[to] && !boxAt[to]) pulls.emplace_back(i, dir);
+            }
+        }
+        for (const auto& pull : pulls) {
+            int box = boxes[pull.first];
+            int from = box + room.offsets[pull.second];
+            int to = from + room.offsets[pull.second];
+            boxAt[box] = 0;
+            boxAt[from] = 1;
+            int region = room.reach(to, boxAt);
+            boxAt[from] = 0;
+            boxAt[box] = 1;
+
+            std::copy(boxes.begin(), boxes.begin() + k, next.begin());
+            next[pull.first] = from;
+            std::sort(next.begin(), next.end());
+            if (!seen.insert(keyOf(next.data(), k, region)).second) continue;
+            states.insert(states.end(), next.begin(), next.end());
+            states.push_back(region);
+            depths.push_back(depth + 1);
+        }
+        for (size_t i = 0; i < k; ++i) boxAt[boxes[i]] = 0;
+    }
+    best.states = depths.size();
+    return best;
+}
+
+}
+
+LevelGenerator::LevelGenerator(const GeneratorOptions& options) : options(options) {}
+
+GeneratedLevel LevelGenerator::generate(int index) const {
+    GeneratedLevel level;
+    std::mt19937 rng(options.seed * 2654435761u + static_cast<unsigned>(index) * 40503u + 1);
+    // Solvers are reused per thread; each one owns a transposition table
+    static thread_local Solver solver(1 << 16);
+
+    for (int attempt = 1; attempt <= options.attempts; ++attempt) {
+        level.attempts = attempt;
+        int span = options.maxSize - options.minSize + 1;
+        int w = options.minSize + static_cast<int>(rng() % span);
+        int h = options.minSize + static_cast<int>(rng() % span);
+        Candidate room(w, h, rng);
+        room.carve();
+
+        std::vector<int> open = room.floorCells();
+        if (static_cast<int>(open.size()) < options.boxes * 3 + options.ghosts + 2) continue;
+        std::shuffle(open.begin(), open.end(), rng);
+        std::vector<int> goals(open.begin(), open.begin() + options.boxes);
+
+        Found found = pullFromGoals(room, goals, options.searchStates);
+        if (found.depth < options.minPushes) continue;
+
+        // Dress the room: the player goes anywhere in its region off a goal
+        // and the ghosts start as far from the player as the room allows
+        std::vector<char> tiles(w * h, '#');
+        std::vector<char> boxAt(w * h, 0);
+        for (int i = 0; i < w * h; ++i) {
+            if (room.floor[i]) tiles[i] = '.';
+        }
+        for (int g : goals) tiles[g] = 'a';
+        for (int b : found.boxes) {
+            tiles[b] = tiles[b] == 'a' ? '1' : 'A';
+            boxAt[b] = 1;
+        }
+        room.reach(found.player, boxAt);
+        std::vector<int> spots;
+        for (int i = 0; i < w * h; ++i) {
+            if (room.reached(i) && tiles[i] == '.') spots.push_back(i);
+        }
+        if (spots.empty()) continue;
+        int player = spots[rng() % spots.size()];
+        tiles[player] = '@';
+
+        std::vector<int> distance(w * h, -1);
+        std::vector<int> queue{player};
+        distance[player] = 0;
+        for (size_t head = 0; head < queue.size(); ++head) {
+            for (int dir = 0; dir < 4; ++dir) {
+                int next = queue[head] + room.offsets[dir];
+                if (!room.floor[next] || distance[next] >= 0) continue;
+                distance[next] = distance[queue[head]] + 1;
+                queue.push_back(next);
+            }
+        }
+        std::vector<int> lairs;
+        for (int cell : queue) {
+            if (tiles[cell] == '.') lairs.push_back(cell);
+        }
+        if (static_cast<int>(lairs.size()) < options.ghosts) continue;
+        // Farthest tiles come last in BFS order; pick among the far half
+        std::vector<int> far(lairs.begin() + lairs.size() / 2, lairs.end());
+        std::shuffle(far.begin(), far.end(), rng);
+        std::vector<Point> enemies;
+        for (int g = 0; g < options.ghosts && g < static_cast<int>(far.size()); ++g) {
+            tiles[far[g]] = 'G';
+            enemies.push_back(Point{far[g] % w, far[g] / w});
+        }
+
+        GameState state;
+        state.load(w, h, tiles, Point{player % w, player / w}, enemies);
+        SolverResult result = solver.solve(state, options.solverNodes);
+        if (!result.solved) continue;
+
+        // Crop the walls the walk never reached, keeping a one-tile border
+        int left = w, right = 0, top = h, bottom = 0;
+        for (int i = 0; i < w * h; ++i) {
+            if (!room.floor[i]) continue;
+            left = std::min(left, i % w - 1);
+            right = std::max(right, i % w + 1);
+            top = std::min(top, i / w - 1);
+            bottom = std::max(bottom, i / w + 1);
+        }
+        level.valid = true;
+        level.width = right - left + 1;
+        level.height = bottom - top + 1;
+        level.tiles.clear();
+        for (int y = top; y <= bottom; ++y) {
+            level.tiles.insert(level.tiles.end(), tiles.begin() + y * w + left, tiles.begin() + y * w + right + 1);
+        }
+        level.player = Point{player % w - left, player / w - top};
+        for (Point& e : enemies) {
+            e = Point{e.x - left, e.y - top};
+        }
+        level.enemies = std::move(enemies);
+        level.pushes = found.depth;
+        level.reverseStates = found.states;
+        level.solverNodes = result.nodes;
+        return level;
+    }
+    return level;
+}
+
+std::vector<GeneratedLevel> LevelGenerator::generateBatch(int count) const {
+    std::vector<GeneratedLevel> levels(count);
+    WorkPool pool(options.threads);
+    for (int i = 0; i < count; ++i) {
+        pool.submit([this, &levels, i] { levels[i] = generate(i); });
+    }
+    pool.wait();
+    return levels;
+}
+
+void LevelGenerator::write(std::ostream& out, const GeneratedLevel& level) {
+    out << level.height << " " << level.width << "\n";
+    for (int y = 0; y < level.height; ++y) {
+        for (int x = 0; x < level.width; ++x) {
+            out << level.tiles[x + y * level.width] << (x + 1 < level.width ? " " : "\n");
+        }
+    }
+}
+
+} // namespace SB
@@ -0,0 +1,64 @@
+#ifndef LevelGenerator_HPP
+#define LevelGenerator_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "GameState.hpp"
+
+namespace SB {
+
+struct GeneratorOptions {
+    int minSize = 7;            // outer width/height, border included
+    int maxSize = 10;
+    int boxes = 3;
+    int ghosts = 1;
+    int minPushes = 6;          // easier candidates are thrown away
+    int searchStates = 4000;    // reverse-search budget per candidate
+    int attempts = 200;         // candidates tried per level
+    std::uint64_t solverNodes = 200000;
+    unsigned seed = 1;
+    unsigned threads = 0;
+};
+
+struct GeneratedLevel {
+    bool valid = false;
+    int width = 0;
+    int height = 0;
+    std::vector<char> tiles;
+    Point player{-1, -1};
+    std::vector<Point> enemies;
+    // Fewest pushes that solve the level, found by the reverse search; the
+    // difficulty metric
+    int pushes = 0;
+    // Distinct box layouts the reverse search saw within `pushes` pulls
+    std::uint64_t reverseStates = 0;
+    // Forward solver effort spent verifying the level
+    std::uint64_t solverNodes = 0;
+    int attempts = 0;
+};
+
+// Builds levels backwards. A random room is carved out, goals are dropped
+// on it, and a breadth-first search pulls the boxes away from the goals.
+// The layout the most pulls away becomes the start, so its depth is the
+// optimal number of pushes. Every level is then solved forwards with Solver
+// before it is accepted. Level `index` depends only on the options and the
+// index, so a batch is reproducible whatever the thread count.
+class LevelGenerator {
+public:
+    explicit LevelGenerator(const GeneratorOptions& options);
+
+    GeneratedLevel generate(int index) const;
+    // Generates levels [0, count) on a WorkPool.
+    std::vector<GeneratedLevel> generateBatch(int count) const;
+
+    // Writes the level in the .lvl text format
+    static void write(std::ostream& out, const GeneratedLevel& level);
+
+private:
+    GeneratorOptions options;
+};
+
+} // namespace SB
+
+#endif // LevelGenerator_HPP
@@ -0,0 +1,173 @@
+#include "MoveLog.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace SB {
+
+MoveLog::MoveLog(size_t capacityBytes) : ring(capacityBytes), enemies(0), begin(0), cursor(0), end(0) {}
+
+void MoveLog::reset(size_t enemyCount) {
+    enemies = enemyCount;
+    begin = cursor = end = 0;
+}
+
+std::uint8_t MoveLog::at(std::uint64_t pos) const {
+    return ring[pos % ring.size()];
+}
+
+size_t MoveLog::entryLength(std::uint8_t marker) const {
+    return (marker & kTick) ? (enemies * 2 * (marker & kWidth) + 7) / 8 + 2 : 1;
+}
+
+// Writing anything new forgets the redo tail, then evicts whole moves from
+// the old end, each with the enemy entry after it, until the new one fits.
+// Once moves have been evicted, an enemy entry with no move left to follow
+// is not written either: undo would take it for the log's opening ticks.
+void MoveLog::append(const std::uint8_t* bytes, size_t length) {
+    if (length > ring.size()) {
+        begin = cursor = end = 0;
+        return;
+    }
+    end = cursor;
+    while (end + length - begin > ring.size()) {
+        begin += entryLength(at(begin));
+        if (begin < end && (at(begin) & kTick)) begin += entryLength(at(begin));
+    }
+    if (begin > 0 && begin == end && (bytes[0] & kTick)) {
+        cursor = end;
+        return;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        ring[(end + i) % ring.size()] = bytes[i];
+    }
+    cursor = end = end + length;
+}
+
+void MoveLog::recordMove(Direction direction, bool pushed, Direction facing) {
+    std::uint8_t entry = static_cast<std::uint8_t>(direction) | (pushed ? 0x04 : 0) |
+                         static_cast<std::uint8_t>(facing << 3);
+    append(&entry, 1);
+}
+
+// Adds this tick's offsets to the enemy entry already closing the log, if
+// there is one, and writes that back in place of it
+void MoveLog::recordTick(const std::vector<Point>& before, const std::vector<Point>& after) {
+    std::vector<Point> offsets(enemies, Point{0, 0});
+    bool anyMoved = false;
+    for (size_t i = 0; i < enemies && i < before.size(); ++i) {
+        offsets[i] = Point{after[i].x - before[i].x, after[i].y - before[i].y};
+        anyMoved = anyMoved || offsets[i] != Point{0, 0};
+    }
+    if (!anyMoved) return;
+
+    end = cursor;
+    if (end > begin && (at(end - 1) & kTick)) {
+        std::uint64_t last = end - entryLength(at(end - 1));
+        std::vector<Point> earlier = readTick(last);
+        anyMoved = false;
+        for (size_t i = 0; i < enemies; ++i) {
+            offsets[i] = Point{offsets[i].x + earlier[i].x, offsets[i].y + earlier[i].y};
+            anyMoved = anyMoved || offsets[i] != Point{0, 0};
+        }
+        cursor = end = last;
+    }
+    // Enemies back where the move left them need no entry at all
+    if (anyMoved) appendTick(offsets);
+}
+
+void MoveLog::appendTick(const std::vector<Point>& offsets) {
+    int largest = 0;
+    for (const Point& d : offsets) largest = std::max({largest, std::abs(d.x), std::abs(d.y)});
+    unsigned width = 2;
+    while ((1 << (width - 1)) - 1 < largest) ++width;
+
+    std::uint8_t marker = static_cast<std::uint8_t>(kTick | width);
+    scratch.assign(entryLength(marker), 0);
+    scratch.front() = marker;
+    scratch.back() = marker;
+    size_t bit = 8;
+    for (const Point& d : offsets) {
+        for (int value : {d.x, d.y}) {
+            unsigned bits = static_cast<unsigned>(value) & ((1u << width) - 1);
+            for (unsigned b = 0; b < width; ++b, ++bit) {
+                if (bits & (1u << b)) scratch[bit / 8] |= 1u << (bit % 8);
+            }
+        }
+    }
+    append(scratch.data(), scratch.size());
+}
+
+std::vector<Point> MoveLog::readTick(std::uint64_t pos) const {
+    unsigned width = at(pos) & kWidth;
+    std::vector<Point> offsets(enemies);
+    std::uint64_t bit = 8;
+    for (Point& d : offsets) {
+        for (int* value : {&d.x, &d.y}) {
+            unsigned bits = 0;
+            for (unsigned b = 0; b < width; ++b, ++bit) {
+                if (at(pos + bit / 8) & (1u << (bit % 8))) bits |= 1u << b;
+            }
+            if (bits & (1u << (width - 1))) bits |= ~((1u << width) - 1);
+            *value = static_cast<int>(bits);
+        }
+    }
+    return offsets;
+}
+
+void MoveLog::applyTick(GameState& state, std::uint64_t pos, bool forward) const {
+    std::vector<Point> locs = state.enemyLocs();
+    std::vector<Point> offsets = readTick(pos);
+    int sign = forward ? 1 : -1;
+    for (size_t i = 0; i < enemies && i < locs.size(); ++i) {
+        locs[i] = Point{locs[i].x + sign * offsets[i].x, locs[i].y + sign * offsets[i].y};
+    }
+    state.setEnemyLocs(locs);
+}
+
+// The enemy entry, if any, then the move it followed. Only the oldest entry
+// left in the log can be enemy moves with no move before them.
+bool MoveLog::undo(GameState& state) {
+    if (cursor == begin) return false;
+    std::uint8_t marker = at(cursor - 1);
+    if (marker & kTick) {
+        cursor -= entryLength(marker);
+        applyTick(state, cursor, false);
+        if (cursor == begin) return true;
+        marker = at(cursor - 1);
+    }
+    cursor -= 1;
+    state.undoStep(static_cast<Direction>(marker & 0x03), (marker & 0x04) != 0,
+                   static_cast<Direction>((marker >> 3) & 0x03));
+    return true;
+}
+
+bool MoveLog::redo(GameState& state) {
+    if (cursor == end) return false;
+    std::uint8_t marker = at(cursor);
+    if (!(marker & kTick)) {
+        state.step(static_cast<Direction>(marker & 0x03));
+        cursor += 1;
+        if (cursor == end) return true;
+        marker = at(cursor);
+    }
+    if (marker & kTick) {
+        applyTick(state, cursor, true);
+        cursor += entryLength(marker);
+    }
+    return true;
+}
+
+bool MoveLog::canUndo() const {
+    return cursor != begin;
+}
+
+bool MoveLog::canRedo() const {
+    return cursor != end;
+}
+
+size_t MoveLog::bytesUsed() const {
+    return end - begin;
+}
+
+} // namespace SB
@@ -0,0 +1,58 @@
+#ifndef MoveLog_HPP
+#define MoveLog_HPP
+
+#include <cstdint>
+#include <vector>
+#include "GameState.hpp"
+
+namespace SB {
+
+// Undo/redo history stored as packed deltas in a fixed-size byte ring.
+//
+// A player move is one byte (direction, whether a box was pushed and the
+// way the player faced before it, which undo turns them back to). The enemy
+// ticks after a move share one entry holding each enemy's net x and y
+// offset since the move, in as few two's complement bits as the largest
+// needs: a marker byte with that width, the offsets and a closing marker, so
+// the log can be walked in either direction. A tick folds itself into the
+// entry at the end of the log, so one undo, which takes back the last
+// player move together with the enemy moves after it, reads at most two
+// entries whatever the number of ticks. When the ring is full the oldest
+// moves are dropped along with their enemy entries.
+class MoveLog {
+public:
+    explicit MoveLog(size_t capacityBytes = 1 << 16);
+
+    void reset(size_t enemyCount);
+    void recordMove(Direction direction, bool pushed, Direction facing);
+    void recordTick(const std::vector<Point>& before, const std::vector<Point>& after);
+
+    bool undo(GameState& state);
+    bool redo(GameState& state);
+    bool canUndo() const;
+    bool canRedo() const;
+    size_t bytesUsed() const;
+
+private:
+    static const std::uint8_t kTick = 0x80;
+    static const std::uint8_t kWidth = 0x1F;
+
+    std::uint8_t at(std::uint64_t pos) const;
+    size_t entryLength(std::uint8_t marker) const;
+    void append(const std::uint8_t* bytes, size_t length);
+    void appendTick(const std::vector<Point>& offsets);
+    std::vector<Point> readTick(std::uint64_t pos) const;
+    void applyTick(GameState& state, std::uint64_t pos, bool forward) const;
+
+    std::vector<std::uint8_t> ring;
+    std::vector<std::uint8_t> scratch;
+    size_t enemies;
+    // Logical byte offsets, reduced modulo the ring size on access
+    std::uint64_t begin;
+    std::uint64_t cursor;
+    std::uint64_t end;
+};
+
+} // namespace SB
+
+#endif // MoveLog_HPP
@@ -0,0 +1,134 @@
+#include "PathContext.hpp"
+
+namespace SB {
+
+void IndexedHeap::reset(int capacity) {
+    items.clear();
+    items.reserve(capacity);
+    keys.assign(capacity, 0);
+    slot.assign(capacity, -1);
+}
+
+void IndexedHeap::clear() {
+    for (int id : items) slot[id] = -1;
+    items.clear();
+    pushed = 0;
+}
+
+bool IndexedHeap::empty() const {
+    return items.empty();
+}
+
+bool IndexedHeap::contains(int id) const {
+    return slot[id] != -1;
+}
+
+void IndexedHeap::push(int id, int key) {
+    ++pushed;
+    keys[id] = key;
+    items.push_back(id);
+    slot[id] = static_cast<int>(items.size()) - 1;
+    siftUp(items.size() - 1);
+}
+
+void IndexedHeap::decrease(int id, int key) {
+    if (!contains(id)) {
+        push(id, key);
+        return;
+    }
+    keys[id] = key;
+    siftUp(slot[id]);
+}
+
+int IndexedHeap::pop() {
+    int top = items.front();
+    slot[top] = -1;
+    int last = items.back();
+    items.pop_back();
+    if (!items.empty()) {
+        place(0, last);
+        siftDown(0);
+    }
+    return top;
+}
+
+unsigned IndexedHeap::pushes() const {
+    return pushed;
+}
+
+void IndexedHeap::place(size_t i, int id) {
+    items[i] = id;
+    slot[id] = static_cast<int>(i);
+}
+
+void IndexedHeap::siftUp(size_t i) {
+    int id = items[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (keys[items[parent]] <= keys[id]) break;
+        place(i, items[parent]);
+        i = parent;
+    }
+    place(i, id);
+}
+
+void IndexedHeap::siftDown(size_t i) {
+    int id = items[i];
+    size_t n = items.size();
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= n) break;
+        if (child + 1 < n && keys[items[child + 1]] < keys[items[child]]) ++child;
+        if (keys[items[child]] >= keys[id]) break;
+        place(i, items[child]);
+        i = child;
+    }
+    place(i, id);
+}
+
+PathContext::PathContext() : w(0), h(0), generation(0), blockGeneration(0), expansions(0) {}
+
+void PathContext::resize(int width, int height) {
+    w = width;
+    h = height;
+    generation = 0;
+    blockGeneration = 1;
+    stamp.assign(w * h, 0);
+    blockedStamp.assign(w * h, 0);
+    g.resize(w * h);
+    parent.resize(w * h);
+    closed.resize(w * h);
+    open.reset(w * h);
+}
+
+void PathContext::nextGeneration() {
+    if (++generation == 0) {
+        std::fill(stamp.begin(), stamp.end(), 0);
+        generation = 1;
+    }
+}
+
+bool PathContext::touched(int cell) const {
+    return stamp[cell] == generation;
+}
+
+void PathContext::clearBlocks() {
+    if (++blockGeneration == 0) {
+        std::fill(blockedStamp.begin(), blockedStamp.end(), 0);
+        blockGeneration = 1;
+    }
+}
+
+void PathContext::block(int cell) {
+    if (cell >= 0 && cell < w * h) blockedStamp[cell] = blockGeneration;
+}
+
+unsigned PathContext::expanded() const {
+    return expansions;
+}
+
+unsigned PathContext::pushes() const {
+    return open.pushes();
+}
+
+} // namespace SB
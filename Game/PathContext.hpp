@@ -0,0 +1,123 @@
+#ifndef PathContext_HPP
+#define PathContext_HPP
+
+#include <algorithm>
+#include <vector>
+
+namespace SB {
+
+// Binary min-heap of node ids with an id -> slot index, so a node already in
+// the open list can have its key lowered in place instead of being pushed
+// again.
+class IndexedHeap {
+public:
+    void reset(int capacity);
+    void clear();
+    bool empty() const;
+    bool contains(int id) const;
+    void push(int id, int key);
+    void decrease(int id, int key);
+    int pop();
+    // Pushes since the last clear()
+    unsigned pushes() const;
+
+private:
+    void siftUp(size_t i);
+    void siftDown(size_t i);
+    void place(size_t i, int id);
+
+    std::vector<int> items;
+    std::vector<int> keys;
+    std::vector<int> slot;
+    unsigned pushed = 0;
+};
+
+// Scratch state for grid A*, kept alive between searches. Per-node data is
+// stored as flat arrays indexed by cell and is only trusted when its stamp
+// matches the current generation, so starting a search never clears memory.
+class PathContext {
+public:
+    PathContext();
+
+    void resize(int width, int height);
+
+    // A* over the 4-connected grid from `start` to `goal`. `passable(cell)`
+    // decides walkability and `estimate(cell)` must not overestimate the
+    // remaining cost. On success `path` holds the cells from start to goal.
+    template <typename Passable, typename Estimate>
+    bool search(int start, int goal, Passable passable, Estimate estimate, std::vector<int>& path);
+
+    // Extra cells to treat as walls until the next clearBlocks().
+    void clearBlocks();
+    void block(int cell);
+
+    unsigned expanded() const;
+    unsigned pushes() const;
+
+private:
+    void nextGeneration();
+    bool touched(int cell) const;
+
+    int w;
+    int h;
+    unsigned generation;
+    unsigned blockGeneration;
+    unsigned expansions;
+    std::vector<unsigned> stamp;
+    std::vector<unsigned> blockedStamp;
+    std::vector<int> g;
+    std::vector<int> parent;
+    std::vector<char> closed;
+    IndexedHeap open;
+};
+
+template <typename Passable, typename Estimate>
+bool PathContext::search(int start, int goal, Passable passable, Estimate estimate, std::vector<int>& path) {
+    path.clear();
+    expansions = 0;
+    if (start < 0 || goal < 0 || start >= w * h || goal >= w * h) return false;
+
+    nextGeneration();
+    open.clear();
+    stamp[start] = generation;
+    g[start] = 0;
+    parent[start] = -1;
+    closed[start] = false;
+    open.push(start, estimate(start));
+
+    while (!open.empty()) {
+        int current = open.pop();
+        if (current == goal) {
+            for (int c = goal; c != -1; c = parent[c]) path.push_back(c);
+            std::reverse(path.begin(), path.end());
+            return true;
+        }
+        closed[current] = true;
+        ++expansions;
+
+        int x = current % w;
+        int adj[4] = {x + 1 < w ? current + 1 : -1, x > 0 ? current - 1 : -1,
+                      current + w < w * h ? current + w : -1, current - w};
+        for (int n : adj) {
+            if (n < 0 || blockedStamp[n] == blockGeneration || !passable(n)) continue;
+
+            int tentativeG = g[current] + 1;
+            if (!touched(n)) {
+                stamp[n] = generation;
+                closed[n] = false;
+                g[n] = tentativeG;
+                parent[n] = current;
+                open.push(n, tentativeG + estimate(n));
+            } else if (!closed[n] && tentativeG < g[n]) {
+                g[n] = tentativeG;
+                parent[n] = current;
+                open.decrease(n, tentativeG + estimate(n));
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace SB
+
+#endif // PathContext_HPP
@@ -0,0 +1,237 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace SB {
+
+namespace {
+
+const size_t kRingEvents = 1 << 15;
+
+struct Event {
+    std::int32_t zone;
+    std::uint64_t begin;
+    std::uint64_t end;
+};
+
+// Written by one thread at a time. Totals are atomics so that snapshots from
+// other threads read whole values; the writer adds with a plain load and
+// store since nothing else writes them.
+struct Buffer {
+    explicit Buffer(int index) : tid(index), events(kRingEvents), head(0) {
+        for (auto& c : zoneCalls) c.store(0, std::memory_order_relaxed);
+        for (auto& n : zoneNanos) n.store(0, std::memory_order_relaxed);
+        for (auto& c : counters) c.store(0, std::memory_order_relaxed);
+        for (auto& b : frameBuckets) b.store(0, std::memory_order_relaxed);
+    }
+
+    int tid;
+    std::vector<Event> events;
+    std::atomic<std::uint64_t> head;
+    std::atomic<std::uint64_t> zoneCalls[kMaxZones];
+    std::atomic<std::uint64_t> zoneNanos[kMaxZones];
+    std::atomic<std::uint64_t> counters[kCounterCount];
+    std::atomic<std::uint64_t> frameBuckets[kFrameBuckets];
+};
+
+void bump(std::atomic<std::uint64_t>& total, std::uint64_t amount) {
+    total.store(total.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+struct Registry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    std::vector<Buffer*> idle;
+    const char* names[kMaxZones] = {};
+    int zones = 0;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// Returns the thread's buffer to the registry when the thread ends
+struct Holder {
+    ~Holder() {
+        if (!buffer) return;
+        Registry& r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        r.idle.push_back(buffer);
+    }
+
+    Buffer* buffer = nullptr;
+};
+
+thread_local Holder holder;
+
+Buffer& local() {
+    if (!holder.buffer) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        if (!r.idle.empty()) {
+            holder.buffer = r.idle.back();
+            r.idle.pop_back();
+        } else {
+            r.buffers.push_back(std::make_unique<Buffer>(static_cast<int>(r.buffers.size())));
+            holder.buffer = r.buffers.back().get();
+        }
+    }
+    return *holder.buffer;
+}
+
+// Upper edge of a frame bucket, in milliseconds
+double bucketMs(int bucket) {
+    return static_cast<double>(1ull << (bucket + 1)) / 1000;
+}
+
+double percentileMs(const std::uint64_t* buckets, std::uint64_t frames, double fraction) {
+    std::uint64_t seen = 0;
+    for (int b = 0; b < kFrameBuckets; ++b) {
+        seen += buckets[b];
+        if (seen > 0 && seen >= fraction * frames) return bucketMs(b);
+    }
+    return 0;
+}
+
+}
+
+int Profiler::zone(const char* name) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    for (int i = 0; i < r.zones; ++i) {
+        if (std::strcmp(r.names[i], name) == 0) return i;
+    }
+    if (r.zones == kMaxZones) return kMaxZones - 1;
+    r.names[r.zones] = name;
+    return r.zones++;
+}
+
+std::uint64_t Profiler::now() {
+    auto elapsed = std::chrono::steady_clock::now() - registry().epoch;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+void Profiler::record(int zone, std::uint64_t begin, std::uint64_t end) {
+    Buffer& b = local();
+    bump(b.zoneCalls[zone], 1);
+    bump(b.zoneNanos[zone], end - begin);
+    std::uint64_t at = b.head.load(std::memory_order_relaxed);
+    b.events[at % kRingEvents] = Event{zone, begin, end};
+    b.head.store(at + 1, std::memory_order_release);
+}
+
+void Profiler::count(Counter counter, std::uint64_t amount) {
+    bump(local().counters[static_cast<int>(counter)], amount);
+}
+
+void Profiler::frame(std::uint64_t nanos) {
+    std::uint64_t micros = nanos / 1000;
+    int bucket = 0;
+    while (bucket + 1 < kFrameBuckets && (micros >> (bucket + 1)) != 0) ++bucket;
+    bump(local().frameBuckets[bucket], 1);
+}
+
+ProfileSnapshot Profiler::snapshot() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    ProfileSnapshot s;
+    s.zones.resize(r.zones);
+    for (int z = 0; z < r.zones; ++z) s.zones[z].name = r.names[z];
+    for (const auto& b : r.buffers) {
+        for (int z = 0; z < r.zones; ++z) {
+            s.zones[z].calls += b->zoneCalls[z].load(std::memory_order_relaxed);
+            s.zones[z].nanos += b->zoneNanos[z].load(std::memory_order_relaxed);
+        }
+        for (int c = 0; c < kCounterCount; ++c) s.counters[c] += b->counters[c].load(std::memory_order_relaxed);
+        for (int f = 0; f < kFrameBuckets; ++f) s.frameBuckets[f] += b->frameBuckets[f].load(std::memory_order_relaxed);
+    }
+    for (int f = 0; f < kFrameBuckets; ++f) s.frames += s.frameBuckets[f];
+    return s;
+}
+
+const char* Profiler::counterName(Counter counter) {
+    switch (counter) {
+        case Counter::NodesExpanded: return "nodes expanded";
+        case Counter::HeapPushes: return "heap pushes";
+        case Counter::PlannerNodes: return "planner nodes";
+        case Counter::SolverNodes: return "solver nodes";
+        case Counter::DrawCalls: return "draw calls";
+        default: return "?";
+    }
+}
+
+std::string Profiler::describe(const ProfileSnapshot& from, const ProfileSnapshot& to) {
+    std::uint64_t frames = to.frames - from.frames;
+    std::uint64_t buckets[kFrameBuckets];
+    for (int f = 0; f < kFrameBuckets; ++f) buckets[f] = to.frameBuckets[f] - from.frameBuckets[f];
+    double perFrame = 1.0 / std::max<std::uint64_t>(frames, 1);
+
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(2);
+    out << frames << " frames, p50 < " << percentileMs(buckets, frames, 0.5) << "ms, p99 < "
+        << percentileMs(buckets, frames, 0.99) << "ms\n";
+    for (size_t z = 0; z < to.zones.size(); ++z) {
+        std::uint64_t calls = to.zones[z].calls - (z < from.zones.size() ? from.zones[z].calls : 0);
+        std::uint64_t nanos = to.zones[z].nanos - (z < from.zones.size() ? from.zones[z].nanos : 0);
+        if (calls == 0) continue;
+        out << to.zones[z].name << ": " << nanos * perFrame / 1e6 << "ms/frame, "
+            << calls * perFrame << " calls/frame\n";
+    }
+    for (int c = 0; c < kCounterCount; ++c) {
+        std::uint64_t amount = to.counters[c] - from.counters[c];
+        if (amount == 0) continue;
+        out << counterName(static_cast<Counter>(c)) << ": " << amount * perFrame << "/frame\n";
+    }
+    return out.str();
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    std::uint64_t last = 0;
+    for (const auto& b : r.buffers) {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+            << ",\"args\":{\"name\":\"thread " << b->tid << "\"}}";
+        first = false;
+
+        std::uint64_t head = b->head.load(std::memory_order_acquire);
+        std::uint64_t begin = head > kRingEvents ? head - kRingEvents : 0;
+        for (std::uint64_t i = begin; i < head; ++i) {
+            const Event& e = b->events[i % kRingEvents];
+            if (e.zone < 0 || e.zone >= r.zones) continue;
+            out << ",\n{\"name\":\"" << r.names[e.zone] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid
+                << ",\"ts\":" << e.begin / 1000.0 << ",\"dur\":" << (e.end - e.begin) / 1000.0 << "}";
+            last = std::max(last, e.end);
+        }
+    }
+
+    // Counter totals as one sample at the end of the trace
+    out << (first ? "" : ",") << "\n{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"ts\":" << last / 1000.0
+        << ",\"args\":{";
+    for (int c = 0; c < kCounterCount; ++c) {
+        std::uint64_t total = 0;
+        for (const auto& b : r.buffers) total += b->counters[c].load(std::memory_order_relaxed);
+        out << (c ? "," : "") << "\"" << counterName(static_cast<Counter>(c)) << "\":" << total;
+    }
+    out << "}}\n]}\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace SB
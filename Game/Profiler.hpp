@@ -0,0 +1,90 @@
+#ifndef Profiler_HPP
+#define Profiler_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SB {
+
+enum class Counter { NodesExpanded, HeapPushes, PlannerNodes, SolverNodes, DrawCalls, Count };
+
+const int kCounterCount = static_cast<int>(Counter::Count);
+const int kMaxZones = 64;
+// Frame times go in power-of-two buckets of microseconds: bucket k holds
+// frames of [2^k, 2^(k+1)) us, the last one everything longer.
+const int kFrameBuckets = 24;
+
+struct ZoneTotal {
+    const char* name = nullptr;
+    std::uint64_t calls = 0;
+    std::uint64_t nanos = 0;
+};
+
+// Totals since start-up, summed over every thread
+struct ProfileSnapshot {
+    std::vector<ZoneTotal> zones;
+    std::uint64_t counters[kCounterCount] = {};
+    std::uint64_t frameBuckets[kFrameBuckets] = {};
+    std::uint64_t frames = 0;
+};
+
+// Scoped timers and counters. Each thread writes only to its own buffer:
+// a ring of the latest timed scopes for tracing, and running per-zone and
+// per-counter totals for the overlay. Writers never take a lock; a thread
+// takes one only the first time it records anything, to register its
+// buffer. Buffers of finished threads are handed to the next new thread.
+//
+// Everything is compiled in only with SB_PROFILE defined (make PROFILE=1,
+// the default); otherwise the macros below expand to nothing.
+class Profiler {
+public:
+    // Id of a named zone; `name` must outlive the program, e.g. a literal.
+    static int zone(const char* name);
+    // Nanoseconds since the profiler's epoch
+    static std::uint64_t now();
+    static void record(int zone, std::uint64_t begin, std::uint64_t end);
+    static void count(Counter counter, std::uint64_t amount);
+    static void frame(std::uint64_t nanos);
+
+    static ProfileSnapshot snapshot();
+    // Time per frame in each zone and counters per frame between two
+    // snapshots, one line each, for the in-game overlay.
+    static std::string describe(const ProfileSnapshot& from, const ProfileSnapshot& to);
+    // Writes the timed scopes still held in the rings as Chrome trace JSON
+    // (chrome://tracing, Perfetto). Call it once the other threads are idle;
+    // a ring being written meanwhile may yield a few torn events.
+    static bool writeChromeTrace(const std::string& path);
+    static const char* counterName(Counter counter);
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(int zone) : id(zone), begin(Profiler::now()) {}
+    ~ProfileScope() { Profiler::record(id, begin, Profiler::now()); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    int id;
+    std::uint64_t begin;
+};
+
+} // namespace SB
+
+#define SB_PROFILE_JOIN2(a, b) a##b
+#define SB_PROFILE_JOIN(a, b) SB_PROFILE_JOIN2(a, b)
+
+#ifdef SB_PROFILE
+#define SB_PROFILE_SCOPE(name)                                                            \
+    static const int SB_PROFILE_JOIN(sbZone, __LINE__) = ::SB::Profiler::zone(name);      \
+    ::SB::ProfileScope SB_PROFILE_JOIN(sbScope, __LINE__)(SB_PROFILE_JOIN(sbZone, __LINE__))
+#define SB_PROFILE_COUNT(counter, amount) ::SB::Profiler::count(::SB::Counter::counter, (amount))
+#define SB_PROFILE_FRAME(nanos) ::SB::Profiler::frame(nanos)
+#else
+#define SB_PROFILE_SCOPE(name) static_cast<void>(0)
+#define SB_PROFILE_COUNT(counter, amount) static_cast<void>(0)
+#define SB_PROFILE_FRAME(nanos) static_cast<void>(0)
+#endif
+
+#endif // Profiler_HPP
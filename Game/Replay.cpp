@@ -0,0 +1,316 @@
+#include "Replay.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace SB {
+
+namespace {
+
+const std::uint8_t kUndo = 0x10;
+const std::uint8_t kRedo = 0x11;
+const std::uint8_t kRestart = 0x12;
+const std::uint8_t kPlace = 0x20;
+const std::uint8_t kHash = 0x40;
+const std::uint8_t kTick = 0x80;
+
+const std::uint32_t kVersion = 1;
+
+struct Header {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t enemies;
+    std::uint32_t events;
+    std::uint64_t level;
+};
+
+// FNV-1a, fed one value at a time
+class Fnv {
+public:
+    void add(const void* data, size_t length) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < length; ++i) {
+            value = (value ^ bytes[i]) * 0x100000001b3ull;
+        }
+    }
+    void add(Point p) {
+        std::int32_t xy[2] = {p.x, p.y};
+        add(xy, sizeof(xy));
+    }
+
+    std::uint64_t value = 0xcbf29ce484222325ull;
+};
+
+size_t tickBytes(size_t enemies) {
+    return (enemies * 3 + 7) / 8;
+}
+
+}
+
+std::uint64_t levelHash(const GameState& state) {
+    Fnv fnv;
+    std::int32_t size[2] = {state.width(), state.height()};
+    fnv.add(size, sizeof(size));
+    fnv.add(state.tiles().data(), state.tiles().size());
+    fnv.add(state.playerLoc());
+    for (const Point& e : state.enemyLocs()) fnv.add(e);
+    return fnv.value;
+}
+
+std::uint64_t stateHash(const GameState& state) {
+    Fnv fnv;
+    fnv.add(state.tiles().data(), state.tiles().size());
+    fnv.add(state.playerLoc());
+    for (const Point& e : state.enemyLocs()) fnv.add(e);
+    return fnv.value;
+}
+
+ReplayRecorder::ReplayRecorder() : active(false), level(0), enemies(0), count(0) {}
+
+void ReplayRecorder::begin(const GameState& state) {
+    active = true;
+    level = levelHash(state);
+    enemies = static_cast<std::uint32_t>(state.enemyLocs().size());
+    count = 0;
+    stream.clear();
+}
+
+bool ReplayRecorder::recording() const {
+    return active;
+}
+
+void ReplayRecorder::finish(const GameState& state) {
+    if (++count % kHashInterval != 0) return;
+    std::uint64_t hash = stateHash(state);
+    stream.push_back(kHash);
+    stream.insert(stream.end(), reinterpret_cast<const std::uint8_t*>(&hash),
+                  reinterpret_cast<const std::uint8_t*>(&hash) + sizeof(hash));
+}
+
+void ReplayRecorder::recordMove(Direction direction, const GameState& state) {
+    if (!active) return;
+    stream.push_back(static_cast<std::uint8_t>(direction));
+    finish(state);
+}
+
+// A tick where some enemy did not move to a neighbouring tile cannot be
+// packed as directions, so it stores every enemy's cell instead.
+void ReplayRecorder::recordTick(const std::vector<Point>& before, const GameState& state) {
+    if (!active) return;
+    const std::vector<Point>& after = state.enemyLocs();
+    bool adjacent = true;
+    for (size_t i = 0; i < enemies && i < before.size(); ++i) {
+        adjacent = adjacent && std::abs(after[i].x - before[i].x) + std::abs(after[i].y - before[i].y) <= 1;
+    }
+    if (!adjacent) {
+        stream.push_back(kPlace);
+        for (const Point& e : after) {
+            std::uint32_t cell = static_cast<std::uint32_t>(state.getArrayIndex(e.x, e.y));
+            stream.insert(stream.end(), reinterpret_cast<const std::uint8_t*>(&cell),
+                          reinterpret_cast<const std::uint8_t*>(&cell) + sizeof(cell));
+        }
+        finish(state);
+        return;
+    }
+
+    size_t at = stream.size();
+    stream.push_back(kTick);
+    stream.resize(stream.size() + tickBytes(enemies), 0);
+    for (size_t i = 0; i < enemies && i < before.size(); ++i) {
+        int dx = after[i].x - before[i].x;
+        int dy = after[i].y - before[i].y;
+        if (dx == 0 && dy == 0) continue;
+        int dir = dy < 0 ? Up : dy > 0 ? Down : dx < 0 ? Left : Right;
+        unsigned bits = 1u | (dir << 1);
+        for (int b = 0; b < 3; ++b) {
+            if (bits & (1u << b)) {
+                size_t bit = i * 3 + b;
+                stream[at + 1 + bit / 8] |= 1u << (bit % 8);
+            }
+        }
+    }
+    finish(state);
+}
+
+void ReplayRecorder::recordUndo(const GameState& state) {
+    if (!active) return;
+    stream.push_back(kUndo);
+    finish(state);
+}
+
+void ReplayRecorder::recordRedo(const GameState& state) {
+    if (!active) return;
+    stream.push_back(kRedo);
+    finish(state);
+}
+
+void ReplayRecorder::recordRestart(const GameState& state) {
+    if (!active) return;
+    stream.push_back(kRestart);
+    finish(state);
+}
+
+size_t ReplayRecorder::events() const {
+    return count;
+}
+
+bool ReplayRecorder::save(const std::string& path) const {
+    if (!active) return false;
+    Header header;
+    std::memcpy(header.magic, "SBRP", 4);
+    header.version = kVersion;
+    header.enemies = enemies;
+    header.events = count;
+    header.level = level;
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(stream.data()), stream.size());
+    return static_cast<bool>(out);
+}
+
+ReplayPlayer::ReplayPlayer() : level(0), enemies(0), count(0), event(0), offset(0), tickCount(0), firstMismatch(-1) {}
+
+bool ReplayPlayer::open(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    Header header;
+    if (bytes.size() < sizeof(header)) return false;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, "SBRP", 4) != 0 || header.version != kVersion) return false;
+
+    level = header.level;
+    enemies = header.enemies;
+    count = header.events;
+    stream.assign(bytes.begin() + sizeof(header), bytes.end());
+    return true;
+}
+
+bool ReplayPlayer::start(const GameState& state) {
+    if (levelHash(state) != level || state.enemyLocs().size() != enemies) return false;
+    pristine = state;
+    game = pristine;
+    history.reset(enemies);
+    event = offset = tickCount = 0;
+    firstMismatch = -1;
+    checkpoints.clear();
+    return true;
+}
+
+size_t ReplayPlayer::events() const {
+    return count;
+}
+
+size_t ReplayPlayer::position() const {
+    return event;
+}
+
+size_t ReplayPlayer::ticks() const {
+    return tickCount;
+}
+
+const GameState& ReplayPlayer::state() const {
+    return game;
+}
+
+// Each event is applied the way AIGame applies the input it came from, so
+// the undo history evolves exactly as it did while recording.
+bool ReplayPlayer::step() {
+    if (event >= count || offset >= stream.size()) return false;
+    std::uint8_t marker = stream[offset++];
+
+    if (marker & kTick || marker == kPlace) {
+        std::vector<Point> before = game.enemyLocs();
+        locs = before;
+        if (marker == kPlace) {
+            if (offset + enemies * sizeof(std::uint32_t) > stream.size()) return false;
+            for (size_t i = 0; i < enemies; ++i) {
+                std::uint32_t cell;
+                std::memcpy(&cell, &stream[offset + i * sizeof(cell)], sizeof(cell));
+                locs[i] = Point{static_cast<int>(cell % game.width()), static_cast<int>(cell / game.width())};
+            }
+            offset += enemies * sizeof(std::uint32_t);
+        } else {
+            if (offset + tickBytes(enemies) > stream.size()) return false;
+            for (size_t i = 0; i < enemies; ++i) {
+                unsigned bits = 0;
+                for (int b = 0; b < 3; ++b) {
+                    size_t bit = i * 3 + b;
+                    if (stream[offset + bit / 8] & (1u << (bit % 8))) bits |= 1u << b;
+                }
+                if (!(bits & 1)) continue;
+                Point d = GameState::offset(static_cast<Direction>(bits >> 1));
+                locs[i] = Point{locs[i].x + d.x, locs[i].y + d.y};
+            }
+            offset += tickBytes(enemies);
+        }
+        game.setEnemyLocs(locs);
+        history.recordTick(before, game.enemyLocs());
+        ++tickCount;
+    } else if (marker == kUndo) {
+        history.undo(game);
+    } else if (marker == kRedo) {
+        history.redo(game);
+    } else if (marker == kRestart) {
+        game = pristine;
+        history.reset(enemies);
+    } else {
+        Direction direction = static_cast<Direction>(marker & 0x03);
+        Point from = game.playerLoc();
+        Point d = GameState::offset(direction);
+        int x = from.x + d.x;
+        int y = from.y + d.y;
+        bool intoBox = x >= 0 && x < game.width() && y >= 0 && y < game.height() &&
+                       game.occupancy().box(game.getArrayIndex(x, y));
+        Direction facing = game.playerFacing();
+        if (game.step(direction)) history.recordMove(direction, intoBox, facing);
+    }
+    ++event;
+
+    if (offset < stream.size() && stream[offset] == kHash) {
+        std::uint64_t hash = 0;
+        if (offset + 1 + sizeof(hash) <= stream.size()) {
+            std::memcpy(&hash, &stream[offset + 1], sizeof(hash));
+            if (firstMismatch < 0 && hash != stateHash(game)) firstMismatch = static_cast<long>(event);
+        }
+        offset += 1 + sizeof(hash);
+    }
+
+    if (event % kCheckpointInterval == 0 && checkpoints.size() < event / kCheckpointInterval) {
+        checkpoints.push_back(Checkpoint{event, offset, tickCount, game, history});
+    }
+    return true;
+}
+
+void ReplayPlayer::seek(size_t target) {
+    if (target < event) {
+        size_t k = target / kCheckpointInterval;
+        if (k > 0 && k <= checkpoints.size()) {
+            const Checkpoint& from = checkpoints[k - 1];
+            event = from.event;
+            offset = from.offset;
+            tickCount = from.ticks;
+            game = from.state;
+            history = from.history;
+        } else {
+            game = pristine;
+            history.reset(enemies);
+            event = offset = tickCount = 0;
+        }
+    }
+    while (event < target && step()) {}
+}
+
+void ReplayPlayer::playToEnd() {
+    while (step()) {}
+}
+
+long ReplayPlayer::divergence() const {
+    return firstMismatch;
+}
+
+} // namespace SB
@@ -0,0 +1,116 @@
+#ifndef Replay_HPP
+#define Replay_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GameState.hpp"
+#include "MoveLog.hpp"
+
+namespace SB {
+
+// Recorded sessions (.sbrp) hold the level they were played on and every
+// input and enemy tick in order:
+//
+//   Header     magic "SBRP", version, enemy count, event count, level hash
+//   Events     one byte per player move, undo, redo or restart; an enemy
+//              tick is a marker byte and three bits per enemy (moved flag
+//              and direction), or the marker and every enemy's cell if one
+//              of them jumped; every kHashInterval events a marker byte and
+//              the 64-bit hash of the live state
+//
+// Wall-clock time is not stored: only the order of events decides the
+// outcome. Ticks carry the enemies' joint move rather than asking the
+// planner again, since its result depends on its time budget.
+class ReplayRecorder {
+public:
+    ReplayRecorder();
+
+    // Starts a new recording of `level`, as loaded and before any event.
+    void begin(const GameState& level);
+    bool recording() const;
+    // Each call gets the state as it is after the event.
+    void recordMove(Direction direction, const GameState& state);
+    void recordTick(const std::vector<Point>& before, const GameState& state);
+    void recordUndo(const GameState& state);
+    void recordRedo(const GameState& state);
+    void recordRestart(const GameState& state);
+
+    size_t events() const;
+    bool save(const std::string& path) const;
+
+private:
+    static const std::uint32_t kHashInterval = 256;
+
+    // Counts the event just appended and adds a state hash when one is due
+    void finish(const GameState& state);
+
+    bool active;
+    std::uint64_t level;
+    std::uint32_t enemies;
+    std::uint32_t count;
+    std::vector<std::uint8_t> stream;
+};
+
+// Re-simulates a recording headless, as fast as the events can be applied.
+// Every kCheckpointInterval events the player keeps a copy of the state it
+// passed, so seeking backwards restarts from the nearest checkpoint instead
+// of from the first event.
+class ReplayPlayer {
+public:
+    ReplayPlayer();
+
+    bool open(const std::string& path);
+    // Checks that `level` is the one the recording was made on and rewinds
+    // to its start.
+    bool start(const GameState& level);
+
+    size_t events() const;
+    size_t position() const;
+    size_t ticks() const;
+    const GameState& state() const;
+
+    // Applies the next event. Returns false at the end of the recording.
+    bool step();
+    // Plays until `event` events have been applied, or to the end.
+    void seek(size_t event);
+    void playToEnd();
+    // Events played when a stored hash first disagreed with the live state,
+    // or -1 if none has so far. The drift happened after the hash before it.
+    long divergence() const;
+
+private:
+    static const size_t kCheckpointInterval = 4096;
+
+    struct Checkpoint {
+        size_t event;
+        size_t offset;
+        size_t ticks;
+        GameState state;
+        MoveLog history;
+    };
+
+    std::uint64_t level;
+    std::uint32_t enemies;
+    std::uint32_t count;
+    std::vector<std::uint8_t> stream;
+
+    GameState pristine;
+    GameState game;
+    MoveLog history;
+    std::vector<Point> locs;
+    size_t event;
+    size_t offset;
+    size_t tickCount;
+    long firstMismatch;
+    std::vector<Checkpoint> checkpoints;
+};
+
+// Hashes of a level as loaded and of a state in play, used to tie a
+// recording to its level and to catch replays that drift from it.
+std::uint64_t levelHash(const GameState& state);
+std::uint64_t stateHash(const GameState& state);
+
+} // namespace SB
+
+#endif // Replay_HPP
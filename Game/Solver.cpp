@@ -0,0 +1,387 @@
+#include "Solver.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <random>
+
+namespace SB {
+
+namespace {
+
+const int kInfinity = std::numeric_limits<int>::max() / 4;
+
+}
+
+TranspositionTable::TranspositionTable(size_t count) {
+    size_t size = 4;
+    while (size < count) size <<= 1;
+    entries.resize(size);
+    mask = size - 1;
+    clear();
+}
+
+void TranspositionTable::clear() {
+    std::fill(entries.begin(), entries.end(), Entry{0, 0, 0});
+}
+
+bool TranspositionTable::visit(std::uint64_t key, int g, int iteration) {
+    if (key == 0) key = 1;
+    Entry* bucket = &entries[key & mask & ~size_t(3)];
+    Entry* victim = bucket;
+    for (int i = 0; i < 4; ++i) {
+        Entry& e = bucket[i];
+        if (e.key == key) {
+            if (e.iteration == iteration && e.g <= g) return true;
+            e.g = static_cast<std::uint16_t>(g);
+            e.iteration = static_cast<std::uint16_t>(iteration);
+            return false;
+        }
+        bool stale = e.key == 0 || e.iteration != iteration;
+        bool victimStale = victim->key == 0 || victim->iteration != iteration;
+        if ((stale && !victimStale) || (stale == victimStale && e.g > victim->g)) victim = &e;
+    }
+    *victim = Entry{key, static_cast<std::uint16_t>(g), static_cast<std::uint16_t>(iteration)};
+    return false;
+}
+
+size_t TranspositionTable::capacity() const {
+    return entries.size();
+}
+
+size_t TranspositionTable::memoryBytes() const {
+    return entries.size() * sizeof(Entry);
+}
+
+Solver::Solver(size_t tableEntries)
+    : deadlocks(nullptr), w(0), h(0), target(0), offsets{0, 0, 0, 0}, boxHash(0), placed(0), reachStamp(0),
+      table(tableEntries), iteration(0), threshold(0), nextThreshold(0), nodes(0), limit(0) {}
+
+// Fills in the static per-level data: floor and goal masks, Zobrist keys and
+// the minimum number of pushes from each cell to any goal, found by pulling
+// a box backwards from every goal. With `ghostWalls` the ghosts' starting
+// cells are left out of the floor.
+void Solver::prepare(const GameState& state, bool ghostWalls) {
+    deadlocks = &state.deadlocks();
+    w = state.width();
+    h = state.height();
+    const std::vector<char>& tiles = state.tiles();
+    offsets[Up] = -w;
+    offsets[Down] = w;
+    offsets[Left] = -1;
+    offsets[Right] = 1;
+
+    floor.assign(w * h, 0);
+    ghost.assign(w * h, 0);
+    goal.assign(w * h, 0);
+    boxAt.assign(w * h, 0);
+    boxes.clear();
+    goals.clear();
+    for (int i = 0; i < w * h; ++i) {
+        floor[i] = tiles[i] != '#';
+        goal[i] = tiles[i] == 'a' || tiles[i] == '1';
+        boxAt[i] = tiles[i] == 'A' || tiles[i] == '1';
+        if (boxAt[i]) boxes.push_back(i);
+        if (goal[i]) goals.push_back(i);
+    }
+    for (Point e : state.enemyLocs()) {
+        int cell = state.getArrayIndex(e.x, e.y);
+        ghost[cell] = 1;
+        if (ghostWalls) floor[cell] = 0;
+    }
+    // Won once every box is stored or every goal is filled, as in isWon()
+    target = std::min(goals.size(), boxes.size());
+
+    std::mt19937_64 rng(0x5EED5B0C);
+    boxKeys.resize(w * h);
+    playerKeys.resize(w * h);
+    for (int i = 0; i < w * h; ++i) {
+        boxKeys[i] = rng();
+        playerKeys[i] = rng();
+    }
+
+    auto move = [this](int cell, int dir) {
+        int x = cell % w;
+        if ((dir == Left && x == 0) || (dir == Right && x == w - 1)) return -1;
+        int next = cell + offsets[dir];
+        return (next >= 0 && next < w * h && floor[next]) ? next : -1;
+    };
+
+    pushDistance.assign(w * h, kInfinity);
+    goalDistance.assign(goals.size() * w * h, kInfinity);
+    for (size_t k = 0; k < goals.size(); ++k) {
+        int g = goals[k];
+        int* dist = &goalDistance[k * w * h];
+        dist[g] = 0;
+        queue.assign(1, g);
+        for (size_t head = 0; head < queue.size(); ++head) {
+            int t = queue[head];
+            for (int d = 0; d < 4; ++d) {
+                int from = move(t, d);
+                int stand = from < 0 ? -1 : move(from, d);
+                if (stand < 0 || dist[from] != kInfinity) continue;
+                dist[from] = dist[t] + 1;
+                queue.push_back(from);
+            }
+        }
+        for (int i = 0; i < w * h; ++i) pushDistance[i] = std::min(pushDistance[i], dist[i]);
+    }
+
+    boxHash = 0;
+    placed = 0;
+    for (int b : boxes) {
+        boxHash ^= boxKeys[b];
+        placed += goal[b];
+    }
+    reached.assign(w * h, 0);
+    reachStamp = 0;
+    parent.assign(w * h, -1);
+    queue.reserve(w * h);
+}
+
+// Lower bound on the pushes still needed: the cheapest way to pair boxes
+// with distinct goals, each pair costing the box's push distance to that
+// goal with the other boxes ignored. Solved as an assignment problem over
+// the smaller side (Hungarian method).
+int Solver::estimate() const {
+    int nb = static_cast<int>(boxes.size());
+    int ng = static_cast<int>(goals.size());
+    bool boxRows = nb <= ng;
+    int n = boxRows ? nb : ng;
+    int m = boxRows ? ng : nb;
+    if (n == 0) return 0;
+
+    const int unreachable = 1 << 20;
+    auto cost = [&](int i, int j) {
+        int box = boxRows ? boxes[i - 1] : boxes[j - 1];
+        int g = boxRows ? j - 1 : i - 1;
+        int d = goalDistance[g * w * h + box];
+        return d == kInfinity ? unreachable : d;
+    };
+
+    potentialU.assign(n + 1, 0);
+    potentialV.assign(m + 1, 0);
+    match.assign(m + 1, 0);
+    way.assign(m + 1, 0);
+    for (int i = 1; i <= n; ++i) {
+        match[0] = i;
+        int j0 = 0;
+        slack.assign(m + 1, kInfinity);
+        used.assign(m + 1, 0);
+        do {
+            used[j0] = 1;
+            int i0 = match[j0];
+            int delta = kInfinity;
+            int j1 = 0;
+            for (int j = 1; j <= m; ++j) {
+                if (used[j]) continue;
+                int cur = cost(i0, j) - potentialU[i0] - potentialV[j];
+                if (cur < slack[j]) {
+                    slack[j] = cur;
+                    way[j] = j0;
+                }
+                if (slack[j] < delta) {
+                    delta = slack[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= m; ++j) {
+                if (used[j]) {
+                    potentialU[match[j]] += delta;
+                    potentialV[j] -= delta;
+                } else {
+                    slack[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (match[j0] != 0);
+        do {
+            int j1 = way[j0];
+            match[j0] = match[j1];
+            j0 = j1;
+        } while (j0);
+    }
+
+    int total = -potentialV[0];
+    return total >= unreachable ? kInfinity : total;
+}
+
+// Marks every cell the player can walk to and returns the lowest one, which
+// stands in for the player's position in the state key.
+int Solver::reach(int from) {
+    if (++reachStamp == 0) {
+        std::fill(reached.begin(), reached.end(), 0);
+        reachStamp = 1;
+    }
+    int lowest = from;
+    reached[from] = reachStamp;
+    queue.clear();
+    queue.push_back(from);
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int c = queue[head];
+        int x = c % w;
+        int adj[4] = {c - w, c + w, x > 0 ? c - 1 : -1, x + 1 < w ? c + 1 : -1};
+        for (int n : adj) {
+            if (n < 0 || n >= w * h || !floor[n] || boxAt[n] || reached[n] == reachStamp) continue;
+            reached[n] = reachStamp;
+            lowest = std::min(lowest, n);
+            queue.push_back(n);
+        }
+    }
+    return lowest;
+}
+
+bool Solver::dfs(int g, int player) {
+    int f = g + estimate();
+    if (f > threshold) {
+        nextThreshold = std::min(nextThreshold, f);
+        return false;
+    }
+    if (placed >= target) return true;
+    if (++nodes > limit) return false;
+
+    int normal = reach(player);
+    if (table.visit(boxHash ^ playerKeys[normal], g, iteration)) return false;
+
+    if (static_cast<int>(candidates.size()) <= g) candidates.resize(g + 1);
+    std::vector<Push>& pushes = candidates[g];
+    pushes.clear();
+    for (int b : boxes) {
+        int x = b % w;
+        for (int d = 0; d < 4; ++d) {
+            if ((d == Left && x == 0) || (d == Right && x == w - 1)) continue;
+            int to = b + offsets[d];
+            int stand = b - offsets[d];
+            if (to < 0 || to >= w * h || stand < 0 || stand >= w * h) continue;
+            if (!floor[to] || boxAt[to] || reached[stand] != reachStamp) continue;
+            if (target == static_cast<int>(boxes.size()) && deadlocks->isDeadSquare(to)) continue;
+            pushes.push_back(Push{b, d, pushDistance[to] - pushDistance[b]});
+        }
+    }
+    std::stable_sort(pushes.begin(), pushes.end(),
+                     [](const Push& a, const Push& b) { return a.score < b.score; });
+
+    // Deeper calls may grow `candidates`, so index it afresh each time
+    for (size_t i = 0; i < candidates[g].size(); ++i) {
+        Push p = candidates[g][i];
+        int to = p.box + offsets[p.dir];
+        auto slot = std::find(boxes.begin(), boxes.end(), p.box);
+
+        *slot = to;
+        boxAt[p.box] = 0;
+        boxAt[to] = 1;
+        boxHash ^= boxKeys[p.box] ^ boxKeys[to];
+        placed += goal[to] - goal[p.box];
+        line.push_back(p);
+
+        bool frozen = target == static_cast<int>(boxes.size()) &&
+                      deadlocks->isFrozen(to, [this](int cell) { return boxAt[cell] != 0; });
+        // On success leave the boxes where they are; solve() replays the line
+        if (!frozen && dfs(g + 1, p.box)) return true;
+
+        line.pop_back();
+        placed -= goal[to] - goal[p.box];
+        boxHash ^= boxKeys[p.box] ^ boxKeys[to];
+        boxAt[to] = 0;
+        boxAt[p.box] = 1;
+        *std::find(boxes.begin(), boxes.end(), to) = p.box;
+
+        if (nodes > limit) return false;
+    }
+    return false;
+}
+
+// Shortest walk for the player between two cells with the boxes where they
+// currently are, around the ghosts' starting cells where there is a way.
+void Solver::appendWalk(int from, int to, std::vector<Direction>& moves) {
+    for (int avoid = 1; avoid >= 0; --avoid) {
+        parent[from] = -1;
+        if (++reachStamp == 0) reachStamp = 1;
+        reached[from] = reachStamp;
+        queue.assign(1, from);
+        for (size_t head = 0; head < queue.size() && reached[to] != reachStamp; ++head) {
+            int c = queue[head];
+            int x = c % w;
+            for (int d = 0; d < 4; ++d) {
+                if ((d == Left && x == 0) || (d == Right && x == w - 1)) continue;
+                int n = c + offsets[d];
+                if (n < 0 || n >= w * h || !floor[n] || boxAt[n] || reached[n] == reachStamp) continue;
+                if (avoid && ghost[n] && n != to) continue;
+                reached[n] = reachStamp;
+                parent[n] = c;
+                queue.push_back(n);
+            }
+        }
+        if (reached[to] == reachStamp) break;
+    }
+
+    size_t first = moves.size();
+    for (int c = to; c != from; c = parent[c]) {
+        int diff = c - parent[c];
+        moves.push_back(diff == -w ? Up : diff == w ? Down : diff == -1 ? Left : Right);
+    }
+    std::reverse(moves.begin() + first, moves.end());
+}
+
+SolverResult Solver::solve(const GameState& state, std::uint64_t nodeLimit) {
+    SB_PROFILE_SCOPE("solve");
+    auto started = std::chrono::steady_clock::now();
+    SolverResult result;
+    Point start = state.playerLoc();
+    int player = state.getArrayIndex(start.x, start.y);
+    if (player < 0 || player >= state.width() * state.height()) return result;
+
+    // Both searches share the node limit
+    nodes = 0;
+    limit = nodeLimit;
+    bool found = false;
+    bool ghostWalls = true;
+    int passes = state.enemyLocs().empty() ? 1 : 2;
+    for (int pass = 0; pass < passes && !found && nodes <= limit; ++pass) {
+        ghostWalls = pass == 0;
+        prepare(state, ghostWalls);
+        line.clear();
+        table.clear();
+        threshold = estimate();
+        for (iteration = 1; threshold < kInfinity && !found && nodes <= limit; ++iteration) {
+            nextThreshold = kInfinity;
+            found = dfs(0, player);
+            if (!found) threshold = nextThreshold;
+        }
+    }
+
+    result.nodes = nodes;
+    SB_PROFILE_COUNT(SolverNodes, nodes);
+    if (found) {
+        prepare(state, ghostWalls);
+        for (const Push& p : line) {
+            appendWalk(player, p.box - offsets[p.dir], result.moves);
+            result.moves.push_back(static_cast<Direction>(p.dir));
+            int to = p.box + offsets[p.dir];
+            boxAt[p.box] = 0;
+            boxAt[to] = 1;
+            player = p.box;
+        }
+        result.solved = true;
+        result.ghostFree = ghostWalls;
+        result.pushes = static_cast<int>(line.size());
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return result;
+}
+
+std::string Solver::toString(const std::vector<Direction>& moves) {
+    std::string out;
+    for (Direction d : moves) {
+        switch (d) {
+            case Up: out += 'u'; break;
+            case Down: out += 'd'; break;
+            case Left: out += 'l'; break;
+            case Right: out += 'r'; break;
+        }
+    }
+    return out;
+}
+
+} // namespace SB
@@ -0,0 +1,115 @@
+#ifndef Solver_HPP
+#define Solver_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GameState.hpp"
+
+namespace SB {
+
+// Fixed-size hash of visited push states. Entries live in buckets of four;
+// a full bucket evicts a stale entry first, then the one found deepest in
+// the search, since that is the cheapest subtree to rediscover.
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t entries);
+
+    void clear();
+    // Records `key` at cost `g`. Returns true if it was already reached at
+    // no greater cost during the same iteration, i.e. the node can be cut.
+    bool visit(std::uint64_t key, int g, int iteration);
+    size_t capacity() const;
+    size_t memoryBytes() const;
+
+private:
+    struct Entry {
+        std::uint64_t key;
+        std::uint16_t g;
+        std::uint16_t iteration;
+    };
+
+    std::vector<Entry> entries;
+    size_t mask;
+};
+
+struct SolverResult {
+    bool solved = false;
+    // The line keeps clear of every ghost's starting cell. When it is false
+    // the puzzle had no such line and the one found needs some ghost to move
+    // off its cell first; in play a ghost can hold the player up either way.
+    bool ghostFree = false;
+    std::vector<Direction> moves;
+    int pushes = 0;
+    std::uint64_t nodes = 0;
+    double seconds = 0;
+};
+
+// Push-level IDA* for the box puzzle. A first search walls off the cells the
+// ghosts start on; if that finds nothing, a second one treats them as floor,
+// since ghosts move in play. A state is the box layout plus the region the
+// player can walk to, keyed by Zobrist hashing with the player normalised to
+// the lowest reachable cell.
+class Solver {
+public:
+    explicit Solver(size_t tableEntries = 1 << 20);
+
+    SolverResult solve(const GameState& state, std::uint64_t nodeLimit = 20000000);
+
+    static std::string toString(const std::vector<Direction>& moves);
+
+private:
+    struct Push {
+        int box;
+        int dir;
+        int score;
+    };
+
+    void prepare(const GameState& state, bool ghostWalls);
+    int estimate() const;
+    int reach(int from);
+    bool dfs(int g, int player);
+    void appendWalk(int from, int to, std::vector<Direction>& moves);
+
+    const DeadlockAnalysis* deadlocks;
+    int w;
+    int h;
+    int target;
+    int offsets[4];
+    std::vector<char> floor;
+    std::vector<char> ghost;
+    std::vector<char> goal;
+    std::vector<char> boxAt;
+    std::vector<int> boxes;
+    std::vector<int> goals;
+    std::vector<int> pushDistance;
+    std::vector<int> goalDistance;
+    std::vector<std::uint64_t> boxKeys;
+    std::vector<std::uint64_t> playerKeys;
+    std::uint64_t boxHash;
+    int placed;
+
+    std::vector<unsigned> reached;
+    unsigned reachStamp;
+    std::vector<int> queue;
+    std::vector<int> parent;
+    mutable std::vector<int> potentialU;
+    mutable std::vector<int> potentialV;
+    mutable std::vector<int> match;
+    mutable std::vector<int> way;
+    mutable std::vector<int> slack;
+    mutable std::vector<char> used;
+
+    TranspositionTable table;
+    int iteration;
+    int threshold;
+    int nextThreshold;
+    std::uint64_t nodes;
+    std::uint64_t limit;
+    std::vector<std::vector<Push>> candidates;
+    std::vector<Push> line;
+};
+
+} // namespace SB
+
+#endif // Solver_HPP
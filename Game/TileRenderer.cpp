@@ -0,0 +1,182 @@
+#include "TileRenderer.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace SB {
+
+TileRenderer::TileRenderer()
+    : hasAtlas(false), source(nullptr), w(0), h(0), chunksWide(0), chunksHigh(0), built(0), frame(0),
+      dynamic(sf::Triangles) {}
+
+bool TileRenderer::buildAtlas(const std::vector<const sf::Texture*>& textures) {
+    if (textures.size() != SlotCount) return false;
+
+    sf::Image sheet;
+    sheet.create(kTileSize * SlotCount, kTileSize, sf::Color::Transparent);
+    for (int slot = 0; slot < SlotCount; ++slot) {
+        if (!textures[slot]) return false;
+        sf::Image tile = textures[slot]->copyToImage();
+        if (tile.getSize() != sf::Vector2u(kTileSize, kTileSize)) return false;
+        sheet.copy(tile, slot * kTileSize, 0);
+    }
+    hasAtlas = atlas.loadFromImage(sheet);
+    return hasAtlas;
+}
+
+bool TileRenderer::ready() const {
+    return hasAtlas;
+}
+
+// Two triangles covering tile (x, y), textured with the atlas slot.
+void TileRenderer::setQuad(sf::Vertex* quad, int x, int y, Slot slot) {
+    float left = x * kTileSize;
+    float top = y * kTileSize;
+    float u = slot * kTileSize;
+    const float size = kTileSize;
+
+    sf::Vector2f corners[4] = {{left, top}, {left + size, top}, {left + size, top + size}, {left, top + size}};
+    sf::Vector2f uvs[4] = {{u, 0}, {u + size, 0}, {u + size, size}, {u, size}};
+    const int order[6] = {0, 1, 2, 0, 2, 3};
+    for (int i = 0; i < 6; ++i) {
+        quad[i].position = corners[order[i]];
+        quad[i].texCoords = uvs[order[i]];
+        quad[i].color = sf::Color::White;
+    }
+}
+
+void TileRenderer::load(const GameState& state) {
+    source = &state;
+    w = state.width();
+    h = state.height();
+    chunksWide = (w + kChunkSize - 1) / kChunkSize;
+    chunksHigh = (h + kChunkSize - 1) / kChunkSize;
+    chunks.clear();
+    chunks.resize(static_cast<size_t>(chunksWide) * chunksHigh);
+    built = 0;
+    shownBoxes = state.occupancy().boxes();
+    update(state);
+}
+
+// Background quads for every tile of the chunk, then one per box on top
+void TileRenderer::buildChunk(int index) const {
+    Chunk& chunk = chunks[index];
+    int left = index % chunksWide * kChunkSize;
+    int top = index / chunksWide * kChunkSize;
+    int right = std::min(left + kChunkSize, w);
+    int bottom = std::min(top + kChunkSize, h);
+
+    int boxes = 0;
+    for (int y = top; y < bottom; ++y) {
+        for (int x = left; x < right; ++x) boxes += shownBoxes.test(x + y * w);
+    }
+    chunk.vertices.setPrimitiveType(sf::Triangles);
+    chunk.vertices.resize((static_cast<size_t>(right - left) * (bottom - top) + boxes) * 6);
+    size_t at = 0;
+    for (int y = top; y < bottom; ++y) {
+        for (int x = left; x < right; ++x) {
+            char tile = source->tile(x, y);
+            Slot slot = Floor;
+            if (tile == '#') slot = Wall;
+            else if (tile == 'a' || tile == '1') slot = Storage;
+            setQuad(&chunk.vertices[at], x, y, slot);
+            at += 6;
+        }
+    }
+    for (int y = top; y < bottom; ++y) {
+        for (int x = left; x < right; ++x) {
+            if (!shownBoxes.test(x + y * w)) continue;
+            setQuad(&chunk.vertices[at], x, y, Box);
+            at += 6;
+        }
+    }
+    if (chunk.dirty) ++built;
+    chunk.dirty = false;
+}
+
+// Frees every chunk that was not drawn this frame
+void TileRenderer::evictChunks() const {
+    for (Chunk& chunk : chunks) {
+        if (chunk.dirty || chunk.lastDrawn == frame) continue;
+        chunk.vertices = sf::VertexArray();
+        chunk.dirty = true;
+        --built;
+    }
+}
+
+void TileRenderer::update(const GameState& state) {
+    source = &state;
+    const std::vector<Point>& enemies = state.enemyLocs();
+
+    // A box that moved dirties the chunk it left and the one it entered
+    const auto& now = state.occupancy().boxes().words();
+    auto& shown = shownBoxes.words();
+    for (size_t i = 0; i < now.size() && i < shown.size(); ++i) {
+        for (std::uint64_t changed = now[i] ^ shown[i]; changed; changed &= changed - 1) {
+            int cell = static_cast<int>(i * 64) + __builtin_ctzll(changed);
+            Chunk& chunk = chunks[cell % w / kChunkSize + cell / w / kChunkSize * chunksWide];
+            if (!chunk.dirty) {
+                chunk.dirty = true;
+                --built;
+            }
+        }
+        shown[i] = now[i];
+    }
+
+    dynamic.resize((1 + enemies.size()) * 6);
+    size_t at = 0;
+    static const Slot playerSlots[4] = {PlayerUp, PlayerDown, PlayerLeft, PlayerRight};
+    static const Slot enemySlots[4] = {EnemyUp, EnemyDown, EnemyLeft, EnemyRight};
+    Point p = state.playerLoc();
+    setQuad(&dynamic[at], p.x, p.y, playerSlots[state.playerFacing()]);
+    at += 6;
+    for (size_t i = 0; i < enemies.size(); ++i) {
+        setQuad(&dynamic[at], enemies[i].x, enemies[i].y, enemySlots[state.enemyFacing(i)]);
+        at += 6;
+    }
+}
+
+sf::IntRect TileRenderer::visibleTiles(const sf::RenderTarget& target, int width, int height) {
+    const sf::View& view = target.getView();
+    sf::Vector2f center = view.getCenter();
+    sf::Vector2f size = view.getSize();
+    int left = std::max(0, static_cast<int>(std::floor((center.x - size.x / 2) / kTileSize)));
+    int top = std::max(0, static_cast<int>(std::floor((center.y - size.y / 2) / kTileSize)));
+    int right = std::min(width, static_cast<int>(std::ceil((center.x + size.x / 2) / kTileSize)));
+    int bottom = std::min(height, static_cast<int>(std::ceil((center.y + size.y / 2) / kTileSize)));
+    return sf::IntRect(left, top, std::max(0, right - left), std::max(0, bottom - top));
+}
+
+size_t TileRenderer::cachedChunks() const {
+    return built;
+}
+
+void TileRenderer::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    if (!source) return;
+    states.texture = &atlas;
+    ++frame;
+
+    sf::IntRect tiles = visibleTiles(target, w, h);
+    int calls = 1;
+    if (tiles.width > 0 && tiles.height > 0) {
+        int firstX = tiles.left / kChunkSize;
+        int firstY = tiles.top / kChunkSize;
+        int lastX = (tiles.left + tiles.width - 1) / kChunkSize;
+        int lastY = (tiles.top + tiles.height - 1) / kChunkSize;
+        for (int cy = firstY; cy <= lastY; ++cy) {
+            for (int cx = firstX; cx <= lastX; ++cx) {
+                int index = cx + cy * chunksWide;
+                if (chunks[index].dirty) buildChunk(index);
+                chunks[index].lastDrawn = frame;
+                target.draw(chunks[index].vertices, states);
+                ++calls;
+            }
+        }
+    }
+    target.draw(dynamic, states);
+    if (built > kMaxCachedChunks) evictChunks();
+    SB_PROFILE_COUNT(DrawCalls, calls);
+}
+
+} // namespace SB
@@ -0,0 +1,83 @@
+#ifndef TileRenderer_HPP
+#define TileRenderer_HPP
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "GameState.hpp"
+
+namespace SB {
+
+// Draws a GameState in batched calls, visiting only what is in view. All
+// tile and actor images are packed side by side into one atlas texture.
+// The map is cut into kChunkSize square chunks, each with its own vertex
+// array of floor, walls, goals and boxes; a chunk is built the first time
+// it comes into view and rebuilt only after a box in it moves. Actors go
+// into a small per-update layer. Frame cost follows the viewport, not the
+// map: a 2000x2000 level draws the same handful of chunks as a small one.
+class TileRenderer : public sf::Drawable {
+public:
+    static const int kTileSize = 64;
+    static const int kChunkSize = 32;
+    // Built chunks kept around once out of view; past this, the ones not
+    // drawn in the last frame are freed
+    static const size_t kMaxCachedChunks = 256;
+
+    enum Slot {
+        Wall, Box, Floor, Storage,
+        PlayerUp, PlayerDown, PlayerLeft, PlayerRight,
+        EnemyUp, EnemyDown, EnemyLeft, EnemyRight,
+        SlotCount
+    };
+
+    TileRenderer();
+
+    // `textures` is indexed by Slot; every entry must be kTileSize square.
+    bool buildAtlas(const std::vector<const sf::Texture*>& textures);
+    bool ready() const;
+
+    // Starts over for a freshly loaded level. `state` must outlive the
+    // renderer or the next load(), as chunks are built from it on demand.
+    void load(const GameState& state);
+    // Marks the chunks whose boxes changed and refreshes the actors.
+    void update(const GameState& state);
+
+    // Tiles of a `width` x `height` map that the target's view can see, as
+    // a clamped range in tile coordinates.
+    static sf::IntRect visibleTiles(const sf::RenderTarget& target, int width, int height);
+    // Chunk vertex arrays currently built and up to date
+    size_t cachedChunks() const;
+
+protected:
+    virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+private:
+    struct Chunk {
+        sf::VertexArray vertices;
+        // Needs (re)building before it is drawn
+        bool dirty = true;
+        unsigned lastDrawn = 0;
+    };
+
+    static void setQuad(sf::Vertex* quad, int x, int y, Slot slot);
+    void buildChunk(int index) const;
+    void evictChunks() const;
+
+    sf::Texture atlas;
+    bool hasAtlas;
+    const GameState* source;
+    int w;
+    int h;
+    int chunksWide;
+    int chunksHigh;
+    // Boxes as last drawn, diffed against the state to find dirty chunks
+    Bitboard shownBoxes;
+    // Built lazily while drawing, hence mutable
+    mutable std::vector<Chunk> chunks;
+    mutable size_t built;
+    mutable unsigned frame;
+    sf::VertexArray dynamic;
+};
+
+} // namespace SB
+
+#endif // TileRenderer_HPP
@@ -0,0 +1,95 @@
+#include "WorkPool.hpp"
+
+namespace SB {
+
+namespace {
+thread_local const WorkPool* currentPool = nullptr;
+thread_local unsigned currentIndex = 0;
+}
+
+WorkPool::WorkPool(unsigned threads) : queued(0), pending(0), nextQueue(0), stopping(false) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    for (unsigned i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i] { run(i); });
+    }
+}
+
+WorkPool::~WorkPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(idleLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void WorkPool::submit(Task task) {
+    unsigned index = (currentPool == this) ? currentIndex
+                                           : nextQueue.fetch_add(1) % queues.size();
+    ++pending;
+    {
+        std::lock_guard<std::mutex> guard(queues[index]->lock);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    ++queued;
+    // Taking the idle lock orders this against a worker about to sleep
+    { std::lock_guard<std::mutex> guard(idleLock); }
+    wake.notify_one();
+}
+
+void WorkPool::wait() {
+    std::unique_lock<std::mutex> guard(idleLock);
+    drained.wait(guard, [this] { return pending == 0; });
+}
+
+unsigned WorkPool::size() const {
+    return static_cast<unsigned>(workers.size());
+}
+
+bool WorkPool::popLocal(unsigned index, Task& task) {
+    Queue& queue = *queues[index];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.tasks.empty()) return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkPool::steal(unsigned thief, Task& task) {
+    for (size_t k = 1; k < queues.size(); ++k) {
+        Queue& queue = *queues[(thief + k) % queues.size()];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty()) continue;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void WorkPool::run(unsigned index) {
+    currentPool = this;
+    currentIndex = index;
+    while (true) {
+        Task task;
+        if (popLocal(index, task) || steal(index, task)) {
+            --queued;
+            task();
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> guard(idleLock);
+                drained.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(idleLock);
+        wake.wait(guard, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
+
+} // namespace SB
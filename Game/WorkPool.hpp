@@ -0,0 +1,58 @@
+#ifndef WorkPool_HPP
+#define WorkPool_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SB {
+
+// Fixed set of worker threads, each with its own task deque. A worker takes
+// its newest task first and, when it runs dry, steals the oldest task from
+// another worker, so uneven jobs (a big level next to a small one) still
+// keep every core busy.
+class WorkPool {
+public:
+    using Task = std::function<void()>;
+
+    // 0 threads means one per hardware thread
+    explicit WorkPool(unsigned threads = 0);
+    ~WorkPool();
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    // Tasks submitted from a worker go to that worker's own deque.
+    void submit(Task task);
+    // Blocks until every submitted task has finished.
+    void wait();
+    unsigned size() const;
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    void run(unsigned index);
+    bool popLocal(unsigned index, Task& task);
+    bool steal(unsigned thief, Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex idleLock;
+    std::condition_variable wake;
+    std::condition_variable drained;
+    std::atomic<size_t> queued;
+    std::atomic<size_t> pending;
+    std::atomic<unsigned> nextQueue;
+    bool stopping;
+};
+
+} // namespace SB
+
+#endif // WorkPool_HPP
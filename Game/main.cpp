@@ -1,25 +1,35 @@
+#include <chrono>
 #include <filesystem>
 #include <vector>
 #include <string>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <random>
 #include <regex>
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
 #include "AIGame.hpp"
+#include "Assets.hpp"
+#include "BatchEnv.hpp"
+#include "LevelBench.hpp"
+#include "LevelFile.hpp"
+#include "LevelGenerator.hpp"
+#include "Profiler.hpp"
+#include "Replay.hpp"
+#include "Solver.hpp"
 
 namespace fs = std::filesystem;
 
 std::vector<std::string> getLevelFiles(const std::string& folder) {
     std::vector<std::string> levels;
     for (const auto& entry : fs::directory_iterator(folder)) {
-        if (entry.path().extension() == ".lvl") {
+        if (entry.path().extension() == ".lvl" || entry.path().extension() == SB::LevelFile::kExtension) {
             levels.push_back(entry.path().string());
         }
     }
     std::sort(levels.begin(), levels.end(), [](const std::string& a, const std::string& b) {
-        std::regex re("level(\\d+)\\.lvl");
+        std::regex re("level(\\d+)\\.");
         std::smatch ma, mb;
         std::string fa = fs::path(a).filename().string();
         std::string fb = fs::path(b).filename().string();
@@ -31,142 +41,558 @@ std::vector<std::string> getLevelFiles(const std::string& folder) {
     return levels;
 }
 
-int runGame(const std::string& selectedLevel, const sf::Font& font) {
-    std::ifstream input_file(selectedLevel);
-    if (!input_file.is_open()) {
-        std::cerr << "Failed to open file: " << selectedLevel << std::endl;
+int solveLevel(const std::string& path) {
+    SB::GameState state;
+    if (!SB::LevelFile::read(path, state)) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return 1;
+    }
+
+    SB::Solver solver;
+    SB::SolverResult result = solver.solve(state);
+    std::cout << fs::path(path).filename().string() << ": "
+              << (result.solved ? (result.ghostFree ? "solved" : "solved once the ghosts move off") : "no solution found")
+              << ", " << result.pushes << " pushes, " << result.moves.size() << " moves, "
+              << result.nodes << " nodes, " << result.seconds << "s" << std::endl;
+    if (result.solved) std::cout << SB::Solver::toString(result.moves) << std::endl;
+    return result.solved ? 0 : 1;
+}
+
+// --bench-levels [episodes] [--random] [--planner MS] [--threads N]
+int benchLevels(const std::vector<std::string>& args) {
+    SB::BenchOptions options;
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "--random") options.policy = SB::PlayerPolicy::Random;
+        else if (args[i] == "--planner" && i + 1 < args.size()) options.planBudget = std::stod(args[++i]) / 1000;
+        else if (args[i] == "--threads" && i + 1 < args.size()) options.threads = std::stoi(args[++i]);
+        else options.episodes = std::stoi(args[i]);
+    }
+
+    SB::LevelBench bench;
+    for (const auto& path : getLevelFiles("levels/")) {
+        SB::GameState state;
+        if (!SB::LevelFile::read(path, state)) {
+            std::cerr << "Failed to open file: " << path << std::endl;
+            return 1;
+        }
+        bench.addLevel(fs::path(path).filename().string(), state);
+    }
+
+    SB::BenchReport report = bench.run(options);
+    auto print = [](const SB::LevelReport& level) {
+        std::cout << level.name << ": " << level.episodes << " episodes, "
+                  << level.wins << " won, " << level.losses << " lost, " << level.timeouts << " timed out, "
+                  << level.steps << " steps, tick p50 " << level.tickP50 << "us p90 " << level.tickP90
+                  << "us p99 " << level.tickP99 << "us max " << level.tickMax << "us" << std::endl;
+    };
+    for (const auto& level : report.levels) print(level);
+    print(report.total);
+    std::cout << report.total.steps << " steps in " << report.seconds << "s on " << report.threads
+              << " threads: " << static_cast<long long>(report.stepsPerSecond()) << " steps/s, enemies ";
+    if (report.planBudget > 0) std::cout << "planned in " << report.planBudget * 1000 << "ms per tick" << std::endl;
+    else std::cout << "chase greedily" << std::endl;
+    return 0;
+}
+
+// --bench-paths [queries]: grid A* with Manhattan distance, grid A* with
+// landmarks and jump point search on every shipped level, over the same
+// random start/goal pairs
+int benchPaths(const std::vector<std::string>& args) {
+    int queries = args.size() > 1 ? std::stoi(args[1]) : 2000;
+    std::vector<std::string> paths = getLevelFiles("levels/");
+    for (const auto& path : getLevelFiles(".")) paths.push_back(path);
+
+    const char* names[3] = {"A*", "ALT", "JPS"};
+    unsigned long totalExpanded[3] = {0, 0, 0};
+    double totalSeconds[3] = {0, 0, 0};
+    for (const auto& path : paths) {
+        SB::GameState state;
+        if (!SB::LevelFile::read(path, state)) {
+            std::cerr << "Failed to open file: " << path << std::endl;
+            return 1;
+        }
+        std::vector<SB::Point> open;
+        for (int y = 0; y < state.height(); ++y) {
+            for (int x = 0; x < state.width(); ++x) {
+                if (state.occupancy().walkable(state.getArrayIndex(x, y))) open.push_back(SB::Point{x, y});
+            }
+        }
+        if (open.empty()) continue;
+
+        std::mt19937 rng(1);
+        std::vector<std::pair<SB::Point, SB::Point>> pairs;
+        for (int i = 0; i < queries; ++i) {
+            pairs.emplace_back(open[rng() % open.size()], open[rng() % open.size()]);
+        }
+
+        unsigned long expanded[3] = {0, 0, 0};
+        double seconds[3] = {0, 0, 0};
+        std::vector<size_t> lengths;
+        for (int m = 0; m < 3; ++m) {
+            state.setPathMethod(m == 2 ? SB::PathMethod::JumpPoint : SB::PathMethod::AStar);
+            state.setLandmarkHeuristic(m == 1);
+            auto begin = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < pairs.size(); ++i) {
+                size_t length = state.findPathAStar(pairs[i].first, pairs[i].second, pairs[i].first).size();
+                expanded[m] += state.pathExpansions();
+                if (m == 0) lengths.push_back(length);
+                else if (m == 1 && length != lengths[i]) {
+                    std::cerr << path << ": landmark path differs for query " << i << std::endl;
+                    return 1;
+                } else if (m == 2 && lengths[i] > 0 && (length == 0 || length > lengths[i])) {
+                    // Ghosts only block grid A*, so jump points may find shorter paths
+                    std::cerr << path << ": jump point path is longer for query " << i << std::endl;
+                    return 1;
+                }
+            }
+            seconds[m] = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            totalExpanded[m] += expanded[m];
+            totalSeconds[m] += seconds[m];
+        }
+        std::cout << fs::path(path).filename().string() << ":";
+        for (int m = 0; m < 3; ++m) {
+            std::cout << " " << names[m] << " " << expanded[m] << " expanded " << seconds[m] * 1000 << "ms"
+                      << (m < 2 ? "," : "");
+        }
+        const SB::Landmarks& landmarks = state.landmarks();
+        std::cout << "; " << landmarks.count() << " landmarks, " << landmarks.memoryBytes() << " bytes, "
+                  << landmarks.lastBuildSeconds() * 1e6 << "us to build" << std::endl;
+    }
+    std::cout << "total:";
+    for (int m = 0; m < 3; ++m) {
+        std::cout << " " << names[m] << " " << totalExpanded[m] << " expanded " << totalSeconds[m] * 1000 << "ms"
+                  << (m < 2 ? "," : "");
+    }
+    std::cout << std::endl;
+    return 0;
+}
+
+// --bench-batch [instances] [steps] [--threads N]: random play on every
+// shipped level, stepped once through BatchEnv and once through a GameState
+// per instance, with the same actions. Finished instances restart.
+int benchBatch(const std::vector<std::string>& args) {
+    int instances = 1024;
+    int steps = 200;
+    unsigned threads = 1;
+    std::vector<int> counts;
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "--threads" && i + 1 < args.size()) threads = std::stoi(args[++i]);
+        else counts.push_back(std::stoi(args[i]));
+    }
+    if (counts.size() > 0) instances = counts[0];
+    if (counts.size() > 1) steps = counts[1];
+
+    double totalSeconds[2] = {0, 0};
+    long long totalSteps = 0;
+    unsigned used = 1;
+    for (const auto& path : getLevelFiles("levels/")) {
+        SB::GameState level;
+        if (!SB::LevelFile::read(path, level)) {
+            std::cerr << "Failed to open file: " << path << std::endl;
+            return 1;
+        }
+        std::mt19937 rng(1);
+        std::vector<std::int8_t> actions(static_cast<size_t>(instances) * steps);
+        for (auto& action : actions) action = static_cast<std::int8_t>(rng() % 5);
+
+        SB::BatchEnv batch(level, instances, threads);
+        used = batch.threads();
+        std::vector<SB::BatchStatus> batchStatus(static_cast<size_t>(instances) * steps);
+        auto begin = std::chrono::steady_clock::now();
+        for (int s = 0; s < steps; ++s) {
+            batch.step(&actions[static_cast<size_t>(s) * instances]);
+            for (int i = 0; i < instances; ++i) {
+                batchStatus[static_cast<size_t>(s) * instances + i] = batch.status(i);
+                if (batch.status(i) != SB::BatchStatus::Playing) batch.reset(i);
+            }
+        }
+        double batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        std::vector<SB::GameState> games(instances, level);
+        begin = std::chrono::steady_clock::now();
+        int mismatches = 0;
+        for (int s = 0; s < steps; ++s) {
+            for (int i = 0; i < instances; ++i) {
+                SB::GameState& game = games[i];
+                std::int8_t action = actions[static_cast<size_t>(s) * instances + i];
+                if (action != SB::BatchEnv::kWait) game.step(static_cast<SB::Direction>(action));
+                SB::BatchStatus status = SB::BatchStatus::Playing;
+                if (game.isWon()) status = SB::BatchStatus::Won;
+                else if (game.isGameOver()) status = SB::BatchStatus::Lost;
+                else {
+                    game.tickEnemies();
+                    if (game.isGameOver()) status = SB::BatchStatus::Lost;
+                }
+                if (status != batchStatus[static_cast<size_t>(s) * instances + i]) ++mismatches;
+                if (status != SB::BatchStatus::Playing) game = level;
+            }
+        }
+        double loopSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        // Both sides end on the same states, not just the same outcomes
+        for (int i = 0; i < instances; ++i) {
+            const SB::GameState& game = games[i];
+            bool same = batch.player(i).x == game.playerLoc().x && batch.player(i).y == game.playerLoc().y;
+            for (int e = 0; e < batch.enemyCount(); ++e) {
+                same = same && batch.enemy(i, e).x == game.enemyLocs()[e].x && batch.enemy(i, e).y == game.enemyLocs()[e].y;
+            }
+            for (int cell = 0; cell < game.width() * game.height(); ++cell) {
+                char tile = game.tiles()[cell];
+                same = same && batch.box(i, cell) == (tile == 'A' || tile == '1');
+            }
+            if (!same) ++mismatches;
+        }
+        if (mismatches > 0) {
+            std::cerr << path << ": batch and per-instance play differ " << mismatches << " times" << std::endl;
+            return 1;
+        }
+
+        long long total = static_cast<long long>(instances) * steps;
+        totalSteps += total;
+        totalSeconds[0] += batchSeconds;
+        totalSeconds[1] += loopSeconds;
+        std::cout << fs::path(path).filename().string() << ": batch " << static_cast<long long>(total / batchSeconds)
+                  << " steps/s, per instance " << static_cast<long long>(total / loopSeconds) << " steps/s, "
+                  << loopSeconds / batchSeconds << "x" << std::endl;
+    }
+    std::cout << "total: " << totalSteps << " steps of " << instances << " instances on "
+              << used << " threads: batch "
+              << static_cast<long long>(totalSteps / totalSeconds[0]) << " steps/s, per instance "
+              << static_cast<long long>(totalSteps / totalSeconds[1]) << " steps/s, "
+              << totalSeconds[1] / totalSeconds[0] << "x" << std::endl;
+    return 0;
+}
+
+
+// --compile-level <in.lvl> <out.sblv>
+int compileLevel(const std::string& from, const std::string& to) {
+    SB::GameState state;
+    if (!SB::LevelFile::read(from, state)) {
+        std::cerr << "Failed to open file: " << from << std::endl;
+        return 1;
+    }
+    if (!SB::LevelFile::save(state, to)) {
+        std::cerr << "Failed to write file: " << to << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// --generate <count> <dir> [--seed S] [--boxes K] [--ghosts G] [--threads N]
+int generateLevels(const std::vector<std::string>& args) {
+    if (args.size() < 3) {
+        std::cerr << "Usage: --generate <count> <dir> [--seed S] [--boxes K] [--ghosts G] [--threads N]" << std::endl;
         return 1;
     }
+    int count = std::stoi(args[1]);
+    fs::path dir(args[2]);
+    SB::GeneratorOptions options;
+    for (size_t i = 3; i + 1 < args.size(); i += 2) {
+        if (args[i] == "--seed") options.seed = std::stoul(args[i + 1]);
+        else if (args[i] == "--boxes") options.boxes = std::stoi(args[i + 1]);
+        else if (args[i] == "--ghosts") options.ghosts = std::stoi(args[i + 1]);
+        else if (args[i] == "--threads") options.threads = std::stoi(args[i + 1]);
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<SB::GeneratedLevel> levels = SB::LevelGenerator(options).generateBatch(count);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
 
-    sf::Texture wallT, boxT, emptyT, storageT, playerT, up, down, left, right;
-    sf::Texture enemyU, enemyD, enemyL, enemyR;
-    if (!wallT.loadFromFile("Wall.png") ||
-        !boxT.loadFromFile("Crate.png") ||
-        !emptyT.loadFromFile("floor.png") ||
-        !storageT.loadFromFile("Storage.png") ||
-        !enemyU.loadFromFile("E_Up.png") ||
-        !enemyD.loadFromFile("E_Down.png") ||
-        !enemyL.loadFromFile("E_Left.png") ||
-        !enemyR.loadFromFile("E_Right.png") ||
-        !playerT.loadFromFile("P_Down.png") ||
-        !up.loadFromFile("P_Up.png") ||
-        !down.loadFromFile("P_Down.png") ||
-        !left.loadFromFile("P_Left.png") ||
-        !right.loadFromFile("P_Right.png")) return EXIT_FAILURE;
+    fs::create_directories(dir);
+    int written = 0;
+    for (size_t i = 0; i < levels.size(); ++i) {
+        if (!levels[i].valid) continue;
+        std::string name = "level" + std::to_string(i + 1) + ".lvl";
+        std::ofstream out(dir / name);
+        SB::LevelGenerator::write(out, levels[i]);
+        std::cout << name << ": " << levels[i].pushes << " pushes, " << levels[i].reverseStates
+                  << " reverse states, " << levels[i].solverNodes << " solver nodes" << std::endl;
+        ++written;
+    }
+    std::cout << written << " of " << count << " levels verified in " << seconds << "s ("
+              << static_cast<int>(written / seconds) << " levels/s)" << std::endl;
+    return written == count ? 0 : 1;
+}
+
+// --replay <file.sbrp> <level> [--seek N]: re-simulates a recorded session
+// headless and reports where it ends up
+int replaySession(const std::vector<std::string>& args) {
+    if (args.size() < 3) {
+        std::cerr << "Usage: --replay <file.sbrp> <level> [--seek N]" << std::endl;
+        return 1;
+    }
+    SB::GameState level;
+    if (!SB::LevelFile::read(args[2], level)) {
+        std::cerr << "Failed to open file: " << args[2] << std::endl;
+        return 1;
+    }
+    SB::ReplayPlayer replay;
+    if (!replay.open(args[1])) {
+        std::cerr << "Failed to open replay: " << args[1] << std::endl;
+        return 1;
+    }
+    if (!replay.start(level)) {
+        std::cerr << args[1] << " was not recorded on " << args[2] << std::endl;
+        return 1;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    if (args.size() > 4 && args[3] == "--seek") replay.seek(std::stoul(args[4]));
+    else replay.playToEnd();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    const SB::GameState& state = replay.state();
+    SB::Point player = state.playerLoc();
+    std::cout << replay.position() << " of " << replay.events() << " events, " << replay.ticks()
+              << " enemy ticks in " << seconds * 1000 << "ms" << std::endl;
+    std::cout << "player at " << player.x << "," << player.y << ", " << state.boxesPlaced() << " of "
+              << state.boxTotal() << " boxes placed, "
+              << (state.isWon() ? "won" : state.isGameOver() ? "lost" : "playing") << std::endl;
+    if (replay.divergence() >= 0) {
+        std::cout << "diverged from the recording by event " << replay.divergence() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int runGame(const std::string& selectedLevel, SB::Assets& assets, const std::string& recordPath) {
+    const sf::Font& font = *assets.font("OpenSans-Bold.ttf");
+    const sf::Texture& wallT = *assets.texture("Wall.png");
+    const sf::Texture& boxT = *assets.texture("Crate.png");
+    const sf::Texture& emptyT = *assets.texture("floor.png");
+    const sf::Texture& storageT = *assets.texture("Storage.png");
+    const sf::Texture& enemyU = *assets.texture("E_Up.png");
+    const sf::Texture& enemyD = *assets.texture("E_Down.png");
+    const sf::Texture& enemyL = *assets.texture("E_Left.png");
+    const sf::Texture& enemyR = *assets.texture("E_Right.png");
+    const sf::Texture& up = *assets.texture("P_Up.png");
+    const sf::Texture& down = *assets.texture("P_Down.png");
+    const sf::Texture& left = *assets.texture("P_Left.png");
+    const sf::Texture& right = *assets.texture("P_Right.png");
 
     SB::AIGame game;
     game.wall.setTexture(wallT);
     game.box.setTexture(boxT);
     game.empty.setTexture(emptyT);
     game.storage.setTexture(storageT);
-    game.player.setTexture(playerT);
+    game.player.setTexture(down);
+    game.playerUpTex = &up;
+    game.playerDownTex = &down;
+    game.playerLeftTex = &left;
+    game.playerRightTex = &right;
     game.enemyUpTex = &enemyU;
     game.enemyDownTex = &enemyD;
     game.enemyLeftTex = &enemyL;
     game.enemyRightTex = &enemyR;
-    input_file >> game;
-    input_file.close();
-
-    sf::SoundBuffer winBuffer, failBuffer;
-    if (!winBuffer.loadFromFile("sound.wav") || !failBuffer.loadFromFile("fail-trumpet-242645.wav")) return EXIT_FAILURE;
-    sf::Sound winSound(winBuffer), failSound(failBuffer);
-    bool winSoundPlayed = false, failSoundPlayed = false;
-    sf::Clock enemyClock;
-    const sf::Time enemyMoveInterval = sf::milliseconds(500);
+    game.buildAtlas({&wallT, &boxT, &emptyT, &storageT, &up, &down, &left, &right,
+                     &enemyU, &enemyD, &enemyL, &enemyR});
+    if (!recordPath.empty()) game.record();
+    if (!game.load(selectedLevel)) {
+        std::cerr << "Failed to open file: " << selectedLevel << std::endl;
+        return 1;
+    }
+
+    auto saveRecording = [&game, &recordPath]() {
+        if (!recordPath.empty() && !game.saveRecording(recordPath)) {
+            std::cerr << "Failed to write or replay recording: " << recordPath << std::endl;
+        }
+    };
+
+    sf::Sound winSound(*assets.sound("sound.wav")), failSound(*assets.sound("fail-trumpet-242645.wav"));
 
-    sf::RenderWindow window(sf::VideoMode(game.width() * 64, game.height() * 64), "Block Pusher");
+    // Maps bigger than the window scroll with the player
+    const int maxWindowWidth = 1280;
+    const int maxWindowHeight = 768;
+    sf::RenderWindow window(sf::VideoMode(std::min(game.width() * 64, maxWindowWidth),
+                                          std::min(game.height() * 64, maxWindowHeight)), "Block Pusher");
     sf::Text backButton("Go Back", font, 30);
     backButton.setFillColor(sf::Color::White);
     backButton.setPosition((window.getSize().x - backButton.getLocalBounds().width) / 2,
                            (window.getSize().y / 2) + 60);
 
-    bool showEndScreen = false;
+    // Win/lose is only re-evaluated after something changed the board
+    enum class Status { Playing, Won, Lost };
+    auto currentStatus = [&game]() {
+        SB_PROFILE_SCOPE("checkStatus");
+        if (game.isWon()) return Status::Won;
+        if (game.isGameOver()) return Status::Lost;
+        return Status::Playing;
+    };
+    Status status = currentStatus();
+    Status announced = Status::Playing;
+
+    // Enemies advance on a fixed tick. Frames are drawn only when something
+    // changed and no faster than the frame cap; otherwise the loop sleeps.
+    const sf::Time enemyMoveInterval = sf::milliseconds(500);
+    // After a stall (a window drag, a breakpoint, a slow load) only this
+    // many missed ticks are made up; the rest are dropped, so the ghosts
+    // never close several tiles on the player in one frame
+    const int maxCatchUpTicks = 2;
+    const sf::Time frameInterval = sf::microseconds(1000000 / 60);
+    const sf::Time maxIdle = sf::milliseconds(5);
+    sf::Clock clock;
+    sf::Time nextEnemyMove = enemyMoveInterval;
+    sf::Time nextFrame = sf::Time::Zero;
+    bool dirty = true;
+
+    // F3 shows time per frame in each profiled zone, refreshed twice a second
+    const sf::Time overlayInterval = sf::milliseconds(500);
+    bool showProfile = false;
+    sf::Time nextOverlay = sf::Time::Zero;
+    SB::ProfileSnapshot lastSnapshot = SB::Profiler::snapshot();
+    sf::Text overlay("", font, 14);
+    overlay.setFillColor(sf::Color::Yellow);
+    overlay.setPosition(8, 8);
 
     while (window.isOpen()) {
+        [[maybe_unused]] sf::Time frameStart = clock.getElapsedTime();
+        bool changed = false;
         sf::Event event;
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed) window.close();
+            else if (event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus) dirty = true;
             else if (event.type == sf::Event::KeyPressed) {
                 if (event.key.code == sf::Keyboard::R) {
-                    winSoundPlayed = false;
-                    failSoundPlayed = false;
                     game.reset(selectedLevel);
-                    showEndScreen = false;
-                } else if (!game.isWon() && !game.isGameOver()) {
+                    nextEnemyMove = clock.getElapsedTime() + enemyMoveInterval;
+                    changed = true;
+                } else if (event.key.code == sf::Keyboard::U) {
+                    changed = game.undo() || changed;
+                } else if (event.key.code == sf::Keyboard::Y) {
+                    changed = game.redo() || changed;
+                } else if (event.key.code == sf::Keyboard::F3) {
+                    showProfile = !showProfile;
+                    nextOverlay = clock.getElapsedTime();
+                    dirty = true;
+                } else if (status == Status::Playing) {
                     if (event.key.code == sf::Keyboard::Up || event.key.code == sf::Keyboard::W) {
-                        game.player.setTexture(up);
                         game.movePlayer(SB::Direction::Up);
+                        changed = true;
                     } else if (event.key.code == sf::Keyboard::Down || event.key.code == sf::Keyboard::S) {
-                        game.player.setTexture(down);
                         game.movePlayer(SB::Direction::Down);
+                        changed = true;
                     } else if (event.key.code == sf::Keyboard::Left || event.key.code == sf::Keyboard::A) {
-                        game.player.setTexture(left);
                         game.movePlayer(SB::Direction::Left);
+                        changed = true;
                     } else if (event.key.code == sf::Keyboard::Right || event.key.code == sf::Keyboard::D) {
-                        game.player.setTexture(right);
                         game.movePlayer(SB::Direction::Right);
+                        changed = true;
                     }
                 }
-            } else if (showEndScreen && event.type == sf::Event::MouseButtonPressed) {
+            } else if (status != Status::Playing && event.type == sf::Event::MouseButtonPressed) {
                 if (backButton.getGlobalBounds().contains(event.mouseButton.x, event.mouseButton.y)) {
                     window.close();
+                    saveRecording();
                     return 2; // signal to restart
                 }
             }
+            if (changed) status = currentStatus();
         }
 
-        if (!game.isWon() && !game.isGameOver() && enemyClock.getElapsedTime() >= enemyMoveInterval) {
+        sf::Time now = clock.getElapsedTime();
+        if (status != Status::Playing) {
+            nextEnemyMove = now + enemyMoveInterval;
+        }
+        for (int ticks = 0; status == Status::Playing && now >= nextEnemyMove; ++ticks) {
+            if (ticks == maxCatchUpTicks) {
+                nextEnemyMove = now + enemyMoveInterval;
+                break;
+            }
             game.moveEnemies();
-            enemyClock.restart();
-        }
-
-        window.clear();
-        window.draw(game);
-
-        if (game.isWon() || game.isGameOver()) {
-            sf::Text endText(game.isWon() ? "You win!" : "Game Over!", font, 50);
-            endText.setPosition((window.getSize().x - endText.getLocalBounds().width) / 2,
-                                (window.getSize().y - endText.getLocalBounds().height) / 2);
-            window.draw(endText);
-            window.draw(backButton);
-            sf::sleep(sf::seconds(0.1));
-            if (game.isWon() && !winSoundPlayed) {
-                winSound.play();
-                winSoundPlayed = true;
-            } else if (game.isGameOver() && !failSoundPlayed) {
-                failSound.play();
-                failSoundPlayed = true;
+            nextEnemyMove += enemyMoveInterval;
+            changed = true;
+            status = currentStatus();
+        }
+
+        if (showProfile && now >= nextOverlay) {
+            SB::ProfileSnapshot snapshot = SB::Profiler::snapshot();
+            overlay.setString(SB::Profiler::describe(lastSnapshot, snapshot));
+            lastSnapshot = snapshot;
+            nextOverlay = now + overlayInterval;
+            dirty = true;
+        }
+
+        if (changed) {
+            if (status != announced) {
+                if (status == Status::Won) winSound.play();
+                else if (status == Status::Lost) failSound.play();
+                announced = status;
             }
-            showEndScreen = true;
+            dirty = true;
         }
 
-        window.display();
+        if (dirty && now >= nextFrame) {
+            window.clear();
+            sf::Vector2f viewport(window.getSize().x, window.getSize().y);
+            window.setView(game.camera(viewport));
+            window.draw(game);
+            // Text is laid out in window pixels, whatever the camera shows
+            window.setView(sf::View(sf::FloatRect(0, 0, viewport.x, viewport.y)));
+            if (status != Status::Playing) {
+                sf::Text endText(status == Status::Won ? "You win!" : "Game Over!", font, 50);
+                endText.setPosition((window.getSize().x - endText.getLocalBounds().width) / 2,
+                                    (window.getSize().y - endText.getLocalBounds().height) / 2);
+                window.draw(endText);
+                window.draw(backButton);
+            }
+            if (showProfile) window.draw(overlay);
+            window.display();
+            SB_PROFILE_FRAME((clock.getElapsedTime() - frameStart).asMicroseconds() * 1000);
+            dirty = false;
+            nextFrame = now + frameInterval;
+            continue;
+        }
+
+        // Nothing to draw yet: sleep until the next deadline, but wake often
+        // enough that key presses still feel immediate.
+        sf::Time wake = maxIdle;
+        if (status == Status::Playing) wake = std::min(wake, nextEnemyMove - now);
+        if (dirty) wake = std::min(wake, nextFrame - now);
+        if (showProfile) wake = std::min(wake, nextOverlay - now);
+        if (wake > sf::Time::Zero) sf::sleep(wake);
     }
 
+    saveRecording();
     return 0;
 }
 
-int main() {
-    sf::Font font;
-    if (!font.loadFromFile("OpenSans-Bold.ttf")) return EXIT_FAILURE;
+int run(const std::vector<std::string>& args) {
+    if (args.size() == 2 && args[0] == "--solve") return solveLevel(args[1]);
+    if (!args.empty() && args[0] == "--bench-levels") return benchLevels(args);
+    if (!args.empty() && args[0] == "--bench-paths") return benchPaths(args);
+    if (!args.empty() && args[0] == "--bench-batch") return benchBatch(args);
+    if (!args.empty() && args[0] == "--generate") return generateLevels(args);
+    if (args.size() == 3 && args[0] == "--compile-level") return compileLevel(args[1], args[2]);
+    if (!args.empty() && args[0] == "--replay") return replaySession(args);
+    // --record <file.sbrp>: play as usual and save the last level played
+    std::string recordPath = args.size() == 2 && args[0] == "--record" ? args[1] : "";
 
-    while (true) {
-        std::vector<std::string> levels = getLevelFiles("levels/");
-        if (levels.empty()) {
-            std::cerr << "No level files found in ./levels/" << std::endl;
-            return 1;
-        }
+    // Everything is decoded once up front; levels and restarts reuse it
+    SB::Assets assets;
+    if (!assets.preload({"OpenSans-Bold.ttf", "Wall.png", "Crate.png", "floor.png", "Storage.png",
+                         "E_Up.png", "E_Down.png", "E_Left.png", "E_Right.png",
+                         "P_Up.png", "P_Down.png", "P_Left.png", "P_Right.png",
+                         "sound.wav", "fail-trumpet-242645.wav"})) return EXIT_FAILURE;
+    const sf::Font& font = *assets.font("OpenSans-Bold.ttf");
 
-        sf::RenderWindow menu(sf::VideoMode(800, 600), "Select Level");
-        std::vector<sf::Text> levelButtons;
-        for (size_t i = 0; i < levels.size(); ++i) {
-            sf::Text text(fs::path(levels[i]).filename().string(), font, 30);
-            text.setPosition(100, 100 + i * 50);
-            levelButtons.push_back(text);
-        }
+    std::vector<std::string> levels = getLevelFiles("levels/");
+    if (levels.empty()) {
+        std::cerr << "No level files found in ./levels/" << std::endl;
+        return 1;
+    }
+
+    sf::RenderWindow menu(sf::VideoMode(800, 600), "Select Level");
+    std::vector<sf::Text> levelButtons;
+    for (size_t i = 0; i < levels.size(); ++i) {
+        sf::Text text(fs::path(levels[i]).filename().string(), font, 30);
+        text.setPosition(100, 100 + i * 50);
+        levelButtons.push_back(text);
+    }
 
+    // The menu window is hidden while a level runs and shown again after
+    while (true) {
         std::string selectedLevel;
-        while (menu.isOpen()) {
+        while (selectedLevel.empty()) {
             sf::Event event;
             while (menu.pollEvent(event)) {
                 if (event.type == sf::Event::Closed) return 0;
@@ -174,7 +600,6 @@ int main() {
                     for (size_t i = 0; i < levelButtons.size(); ++i) {
                         if (levelButtons[i].getGlobalBounds().contains(event.mouseButton.x, event.mouseButton.y)) {
                             selectedLevel = levels[i];
-                            menu.close();
                         }
                     }
                 }
@@ -184,10 +609,28 @@ int main() {
             menu.display();
         }
 
-        if (selectedLevel.empty()) return 0;
-        int result = runGame(selectedLevel, font);
+        menu.setVisible(false);
+        int result = runGame(selectedLevel, assets, recordPath);
         if (result != 2) break; // 2 means restart, otherwise exit
+        menu.setVisible(true);
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    // --trace <file.json> goes with any mode and is written once it returns
+    std::string tracePath;
+    auto trace = std::find(args.begin(), args.end(), "--trace");
+    if (trace != args.end() && trace + 1 != args.end()) {
+        tracePath = *(trace + 1);
+        args.erase(trace, trace + 2);
+    }
+
+    int status = run(args);
+    if (!tracePath.empty() && !SB::Profiler::writeChromeTrace(tracePath)) {
+        std::cerr << "Failed to write file: " << tracePath << std::endl;
+    }
+    return status;
+}
@@ -0,0 +1,112 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "LevelFile.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Bytes = std::vector<unsigned char>;
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+Bytes readBytes(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return Bytes(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeBytes(const std::string& path, const Bytes& bytes) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+void putU32(Bytes& bytes, size_t at, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) bytes[at + i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+// The field at `at` holds `value` least significant byte first
+bool storedLittleEndian(const Bytes& bytes, size_t at, std::uint32_t value) {
+    if (bytes.size() < at + 4) return false;
+    for (int i = 0; i < 4; ++i) {
+        if (bytes[at + i] != static_cast<unsigned char>(value >> (8 * i))) return false;
+    }
+    return true;
+}
+
+}
+
+// A compiled level stores its header and actor cells little-endian and
+// loads back to the same grid; damaged files are refused rather than read.
+int main() {
+    const std::string source = "levels/level4.lvl";
+    SB::GameState level;
+    if (!SB::LevelFile::read(source, level)) {
+        std::cerr << "Cannot open " << source << "; run from the Game directory" << std::endl;
+        return 1;
+    }
+    const std::string path = (fs::temp_directory_path() / "LevelFileTest.sblv").string();
+    check(SB::LevelFile::save(level, path), "save " + path);
+
+    const Bytes saved = readBytes(path);
+    SB::Point player = level.playerLoc();
+    size_t enemies = level.enemyLocs().size();
+    check(saved.size() >= 4 && std::string(saved.begin(), saved.begin() + 4) == "SBLV", "magic");
+    check(storedLittleEndian(saved, 4, 1), "version byte order");
+    check(storedLittleEndian(saved, 8, level.width()), "width byte order");
+    check(storedLittleEndian(saved, 12, level.height()), "height byte order");
+    check(storedLittleEndian(saved, 16, static_cast<std::uint32_t>(enemies)), "enemy count byte order");
+    check(storedLittleEndian(saved, 20, level.getArrayIndex(player.x, player.y)), "player cell byte order");
+    for (size_t i = 0; i < enemies; ++i) {
+        SB::Point e = level.enemyLocs()[i];
+        check(storedLittleEndian(saved, 24 + 4 * i, level.getArrayIndex(e.x, e.y)), "enemy cell byte order");
+    }
+    size_t tileBytes = (static_cast<size_t>(level.width()) * level.height() + 1) / 2;
+    check(saved.size() == 20 + 4 * (1 + enemies) + tileBytes, "file length");
+
+    SB::GameState loaded;
+    check(SB::LevelFile::read(path, loaded), "load what was saved");
+    check(loaded.width() == level.width() && loaded.height() == level.height(), "round trip size");
+    check(loaded.tiles() == level.tiles(), "round trip tiles");
+    check(loaded.playerLoc() == player, "round trip player");
+    check(loaded.enemyLocs() == level.enemyLocs(), "round trip enemies");
+
+    const std::vector<std::pair<std::string, std::function<void(Bytes&)>>> damage = {
+        {"truncated header", [](Bytes& b) { b.resize(19); }},
+        {"truncated actors", [](Bytes& b) { b.resize(22); }},
+        {"truncated tiles", [](Bytes& b) { b.pop_back(); }},
+        {"empty file", [](Bytes& b) { b.clear(); }},
+        {"bad magic", [](Bytes& b) { b[3] = 'X'; }},
+        {"bad version", [](Bytes& b) { putU32(b, 4, 2); }},
+        {"zero width", [](Bytes& b) { putU32(b, 8, 0); }},
+        {"zero height", [](Bytes& b) { putU32(b, 12, 0); }},
+        {"grid too large to index", [](Bytes& b) { putU32(b, 8, 0x10000); putU32(b, 12, 0x10000); }},
+        {"more enemies than the file holds", [](Bytes& b) { putU32(b, 16, 0xFFFFFF); }},
+        {"player outside the grid", [](Bytes& b) { putU32(b, 20, 0xFFFFFFF0); }},
+        {"enemy absent", [](Bytes& b) { putU32(b, 24, 0xFFFFFFFF); }},
+    };
+    for (const auto& test : damage) {
+        Bytes bytes = saved;
+        test.second(bytes);
+        writeBytes(path, bytes);
+        SB::GameState state;
+        check(!SB::LevelFile::load(path, state), "rejects " + test.first);
+    }
+    check(!SB::LevelFile::load(path + ".missing", loaded), "rejects a missing file");
+
+    fs::remove(path);
+    if (failures == 0) std::cout << source << ": compiled level checks passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
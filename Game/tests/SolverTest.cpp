@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "LevelFile.hpp"
+#include "Solver.hpp"
+
+namespace fs = std::filesystem;
+
+// Every shipped level has a solution and playing it back wins. A line that
+// keeps clear of the ghosts is played with them standing where the level
+// puts them; one that needs them to move off is played without them.
+int main() {
+    std::vector<std::string> paths;
+    for (const char* folder : {"levels/", "."}) {
+        for (const auto& entry : fs::directory_iterator(folder)) {
+            if (entry.path().extension() == ".lvl") paths.push_back(entry.path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    if (paths.empty()) {
+        std::cerr << "No level files found; run from the Game directory" << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    SB::Solver solver;
+    for (const auto& path : paths) {
+        SB::GameState level;
+        if (!SB::LevelFile::read(path, level)) {
+            std::cerr << path << ": failed to open" << std::endl;
+            ++failures;
+            continue;
+        }
+        SB::SolverResult result = solver.solve(level);
+        if (!result.solved) {
+            std::cerr << path << ": no solution found in " << result.nodes << " nodes" << std::endl;
+            ++failures;
+            continue;
+        }
+
+        SB::GameState game = level;
+        if (!result.ghostFree) game.load(level.width(), level.height(), level.tiles(), level.playerLoc(), {});
+        size_t played = 0;
+        while (played < result.moves.size() && game.step(result.moves[played]) && !game.isGameOver()) ++played;
+        if (played < result.moves.size() || !game.isWon()) {
+            SB::Point at = game.playerLoc();
+            std::cerr << path << ": replay " << (game.isGameOver() ? "caught" : "stuck") << " at move " << played
+                      << " of " << result.moves.size() << ", player at " << at.x << "," << at.y << std::endl;
+            ++failures;
+            continue;
+        }
+        std::cout << path << ": " << result.pushes << " pushes, " << result.moves.size() << " moves"
+                  << (result.ghostFree ? "" : ", once the ghosts move off") << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}